@@ -0,0 +1,212 @@
+#include "executor.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+thread_local const CancellationToken *current_token = nullptr;
+
+}  // namespace
+
+CancelledError::CancelledError()
+    : std::runtime_error("Operation was cancelled") {}
+
+CancellationToken::CancellationToken()
+    : cancelled_(std::make_shared<std::atomic<bool>>(false)) {}
+
+void CancellationToken::Cancel() noexcept { *cancelled_ = true; }
+
+bool CancellationToken::IsCancelled() const noexcept { return *cancelled_; }
+
+const CancellationToken &CancellationToken::Current() noexcept {
+  static const CancellationToken never;
+  return current_token ? *current_token : never;
+}
+
+Executor::Executor(int threads)
+    : sequence_(0), stopping_(false), threads_(0) {
+  setThreadCount(threads);
+}
+
+Executor::~Executor() { StopWorkers(); }
+
+Executor &Executor::Instance() {
+  static Executor executor(
+      std::max(1, (int)std::thread::hardware_concurrency()));
+  return executor;
+}
+
+int Executor::getThreadCount() const noexcept { return threads_; }
+
+void Executor::setThreadCount(int threads) {
+  if (threads < 1)
+    throw std::length_error("Invalid input, thread count must be positive");
+  StopWorkers();
+  threads_ = threads;
+  StartWorkers(threads - 1);
+}
+
+bool Executor::Task::operator<(const Task &other) const noexcept {
+  if (priority != other.priority) return priority < other.priority;
+  return sequence > other.sequence;
+}
+
+void Executor::Submit(std::function<void()> task, int priority) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push(Task{priority, sequence_++, std::move(task)});
+  }
+  condition_.notify_all();
+}
+
+void Executor::SubmitJob(std::function<void()> job, int priority,
+                         const CancellationToken &token) {
+  priority = std::max(kJobPriority / 2, std::min(priority, -kJobPriority / 2));
+  auto run = [job = std::move(job), token] {
+    const CancellationToken *outer = current_token;
+    current_token = &token;
+    job();
+    current_token = outer;
+  };
+  if (workers_.empty()) {
+    run();
+  } else {
+    Submit(std::move(run), kJobPriority + priority);
+  }
+}
+
+void Executor::HelpUntil(const std::function<bool()> &done) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!done()) {
+    if (tasks_.empty() || tasks_.top().priority < 0) {
+      condition_.wait(lock);
+      continue;
+    }
+    std::function<void()> work =
+        std::move(const_cast<Task &>(tasks_.top()).work);
+    tasks_.pop();
+    lock.unlock();
+    work();
+    lock.lock();
+  }
+}
+
+void Executor::Notify() {
+  { std::lock_guard<std::mutex> lock(mutex_); }
+  condition_.notify_all();
+}
+
+void Executor::ParallelFor(int first, int last, int grain,
+                           const std::function<void(int, int)> &body,
+                           bool cancellable) {
+  if (grain < 1) grain = 1;
+  if (last - first <= grain || threads_ == 1) {
+    for (int begin = first; begin < last; begin += grain)
+      body(begin, std::min(begin + grain, last));
+    return;
+  }
+  TaskGraph graph;
+  for (int begin = first; begin < last; begin += grain) {
+    int end = std::min(begin + grain, last);
+    graph.Add([&body, begin, end] { body(begin, end); });
+  }
+  graph.setCancellable(cancellable);
+  graph.Run(*this);
+}
+
+void Executor::StartWorkers(int count) {
+  stopping_ = false;
+  for (int i = 0; i < count; i++) {
+    workers_.emplace_back(&Executor::WorkerLoop, this);
+  }
+}
+
+void Executor::StopWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_all();
+  for (std::thread &worker : workers_) worker.join();
+  workers_.clear();
+}
+
+void Executor::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    condition_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+    if (tasks_.empty()) return;
+    std::function<void()> work =
+        std::move(const_cast<Task &>(tasks_.top()).work);
+    tasks_.pop();
+    lock.unlock();
+    work();
+    lock.lock();
+  }
+}
+
+TaskGraph::Node::Node(std::function<void()> work, int priority)
+    : work(std::move(work)), priority(priority), pending(0) {}
+
+TaskGraph::Node::Node(Node &&other) noexcept
+    : work(std::move(other.work)),
+      priority(other.priority),
+      successors(std::move(other.successors)),
+      pending(other.pending.load()) {}
+
+int TaskGraph::Add(std::function<void()> work, int priority) {
+  nodes_.emplace_back(std::move(work), priority);
+  return (int)nodes_.size() - 1;
+}
+
+void TaskGraph::Depend(int task, int prerequisite) {
+  nodes_[prerequisite].successors.push_back(task);
+  nodes_[task].pending++;
+}
+
+void TaskGraph::setCancellable(bool cancellable) noexcept {
+  cancellable_ = cancellable;
+}
+
+void TaskGraph::Run(Executor &executor) {
+  remaining_ = (int)nodes_.size();
+  error_ = nullptr;
+  token_ = CancellationToken::Current();
+  // Корни собираются заранее: после первого Launch счётчики pending
+  // уменьшаются уже запущенными задачами
+  std::vector<int> roots;
+  for (int i = 0; i < (int)nodes_.size(); i++) {
+    if (nodes_[i].pending == 0) roots.push_back(i);
+  }
+  for (int root : roots) Launch(executor, root);
+  executor.HelpUntil([this] { return remaining_ == 0; });
+  if (error_) std::rethrow_exception(error_);
+}
+
+void TaskGraph::Launch(Executor &executor, int task) {
+  executor.Submit(
+      [this, &executor, task] {
+        Node &node = nodes_[task];
+        bool failed;
+        {
+          std::lock_guard<std::mutex> lock(error_mutex_);
+          if (!error_ && cancellable_ && token_.IsCancelled())
+            error_ = std::make_exception_ptr(CancelledError());
+          failed = error_ != nullptr;
+        }
+        if (!failed) {
+          try {
+            node.work();
+          } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex_);
+            if (!error_) error_ = std::current_exception();
+          }
+        }
+        for (int successor : node.successors) {
+          if (--nodes_[successor].pending == 0) Launch(executor, successor);
+        }
+        if (--remaining_ == 0) executor.Notify();
+      },
+      nodes_[task].priority);
+}
@@ -0,0 +1,154 @@
+#ifndef MATRIX_EXECUTOR_H_
+#define MATRIX_EXECUTOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+class CancelledError : public std::runtime_error {
+ public:
+  CancelledError();
+};
+
+// Общий флаг отмены. Задача, запущенная через Executor::Async, проверяет
+// его перед стартом и между задачами тех графов (TaskGraph), которые она
+// запускает с setCancellable(true), и тогда завершается с CancelledError.
+class CancellationToken {
+ public:
+  CancellationToken();
+
+  void Cancel() noexcept;
+  bool IsCancelled() const noexcept;
+
+  // Токен задачи, выполняемой в текущем потоке (никогда не отменяемый
+  // вне Executor::Async)
+  static const CancellationToken &Current() noexcept;
+
+ private:
+  friend class Executor;
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+// Пул потоков библиотеки. При n потоках запускается n - 1 рабочих, n-м
+// становится поток, ожидающий завершения параллельной операции: пока он
+// ждёт, он сам выполняет задачи из очереди. Асинхронные задания (Async)
+// выполняются только рабочими потоками и всегда после внутренних задач
+// уже начатых операций.
+class Executor {
+ public:
+  explicit Executor(int threads);
+  Executor(const Executor &other) = delete;
+  Executor &operator=(const Executor &other) = delete;
+  ~Executor();
+
+  static Executor &Instance();
+
+  int getThreadCount() const noexcept;
+  // Нельзя вызывать, пока в пуле выполняются задачи
+  void setThreadCount(int threads);
+
+  // Задачи с большим priority выполняются раньше, при равном - по порядку
+  void Submit(std::function<void()> task, int priority = 0);
+  // Запускает function() на рабочем потоке. Задания с большим priority
+  // начинаются раньше; отменённое до старта задание не выполняется. Если
+  // рабочих потоков нет, function() выполняется сразу в вызывающем потоке.
+  template <typename Function>
+  auto Async(Function function, int priority = 0,
+             CancellationToken token = CancellationToken())
+      -> std::future<decltype(function())>;
+
+  // Выполняет внутренние задачи в вызывающем потоке, пока done() не вернёт
+  // true (асинхронные задания при этом не берутся)
+  void HelpUntil(const std::function<bool()> &done);
+  // Будит потоки, ожидающие в HelpUntil
+  void Notify();
+  // body(begin, end) для отрезков [first, last) длины не больше grain.
+  // При cancellable отменённое задание Async прерывает цикл с
+  // CancelledError, см. TaskGraph::setCancellable.
+  void ParallelFor(int first, int last, int grain,
+                   const std::function<void(int, int)> &body,
+                   bool cancellable = false);
+
+ private:
+  struct Task {
+    int priority;
+    uint64_t sequence;
+    std::function<void()> work;
+    bool operator<(const Task &other) const noexcept;
+  };
+
+  // Приоритеты заданий Async лежат ниже приоритетов внутренних задач
+  static constexpr int kJobPriority = -(1 << 20);
+
+  void SubmitJob(std::function<void()> job, int priority,
+                 const CancellationToken &token);
+  void StartWorkers(int count);
+  void StopWorkers();
+  void WorkerLoop();
+
+  std::vector<std::thread> workers_;
+  std::priority_queue<Task> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  uint64_t sequence_;
+  bool stopping_;
+  int threads_;
+};
+
+// Граф задач с зависимостями: задача отправляется в пул, когда завершены
+// все её предшественники. Run() возвращается после выполнения всего графа
+// и пробрасывает первое исключение, выброшенное задачами.
+class TaskGraph {
+ public:
+  int Add(std::function<void()> work, int priority = 0);
+  void Depend(int task, int prerequisite);
+  // Граф, запущенный из отменённого задания Async, не начинает новых
+  // задач, и Run() выбрасывает CancelledError. По умолчанию выключено:
+  // графы из noexcept-операций не должны прерываться.
+  void setCancellable(bool cancellable) noexcept;
+  void Run(Executor &executor);
+
+ private:
+  struct Node {
+    std::function<void()> work;
+    int priority;
+    std::vector<int> successors;
+    std::atomic<int> pending;
+    Node(std::function<void()> work, int priority);
+    Node(Node &&other) noexcept;
+  };
+
+  void Launch(Executor &executor, int task);
+
+  std::vector<Node> nodes_;
+  std::atomic<int> remaining_;
+  std::mutex error_mutex_;
+  std::exception_ptr error_;
+  CancellationToken token_;
+  bool cancellable_ = false;
+};
+
+template <typename Function>
+auto Executor::Async(Function function, int priority, CancellationToken token)
+    -> std::future<decltype(function())> {
+  using Result = decltype(function());
+  auto task = std::make_shared<std::packaged_task<Result()>>(
+      [function = std::move(function), token]() mutable {
+        if (token.IsCancelled()) throw CancelledError();
+        return function();
+      });
+  std::future<Result> result = task->get_future();
+  SubmitJob([task] { (*task)(); }, priority, token);
+  return result;
+}
+
+#endif  // MATRIX_EXECUTOR_H_
@@ -0,0 +1,448 @@
+#include "incremental.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "kernels.h"
+
+namespace {
+
+using kernels::Dot;
+using kernels::ParallelGemm;
+
+// Изменение, после которого матрица становится вырожденной с точностью до
+// относительной погрешности kSingular, отклоняется
+const double kSingular = 1e-12;
+
+double Norm(const double *x, int length) {
+  return sqrt(Dot(x, x, length));
+}
+
+// Пробный вектор для проверки точности
+std::vector<double> Probe(int n) {
+  std::mt19937 generator(n);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  std::vector<double> x(n);
+  for (double &value : x) value = uniform(generator);
+  return x;
+}
+
+// Обратная ошибка ||A y - x|| / (||A|| ||y|| + ||x||) в бесконечной норме
+// для приближённого решения y системы A y = x
+double BackwardError(const double *a, int n, const std::vector<double> &x,
+                     const std::vector<double> &y) {
+  double residual = 0, norm = 0, x_norm = 0, y_norm = 0;
+  for (int i = 0; i < n; i++) {
+    const double *ai = a + (size_t)i * n;
+    residual = std::max(residual, fabs(Dot(ai, y.data(), n) - x[i]));
+    double row = 0;
+    for (int j = 0; j < n; j++) row += fabs(ai[j]);
+    norm = std::max(norm, row);
+    x_norm = std::max(x_norm, fabs(x[i]));
+    y_norm = std::max(y_norm, fabs(y[i]));
+  }
+  return residual / (norm * y_norm + x_norm);
+}
+
+// Разложение A = R^T R на месте: на входе в r матрица A (используется
+// верхний треугольник), на выходе R с нулями под диагональю. Строки
+// обновляются целиком, чтобы проходы шли по памяти подряд.
+bool Cholesky(double *r, int n) {
+  for (int i = 0; i < n; i++) {
+    double *ri = r + (size_t)i * n;
+    if (!(ri[i] > 0)) return false;
+    ri[i] = sqrt(ri[i]);
+    for (int j = i + 1; j < n; j++) ri[j] /= ri[i];
+    for (int k = i + 1; k < n; k++) {
+      double *rk = r + (size_t)k * n;
+      for (int j = k; j < n; j++) rk[j] -= ri[k] * ri[j];
+    }
+  }
+  for (int i = 1; i < n; i++)
+    std::fill(r + (size_t)i * n, r + (size_t)i * n + i, 0.0);
+  return true;
+}
+
+// R^T R + sign * x x^T для верхнетреугольной R (n x n, строки через ld)
+// вращениями; x портится. Возвращает false, если при sign = -1 результат
+// перестаёт быть положительно определённым (тогда R испорчена).
+bool RankOneUpdate(double *r, int n, int ld, double *x, double sign) {
+  for (int k = 0; k < n; k++) {
+    double *rk = r + (size_t)k * ld;
+    double d = rk[k] * rk[k] + sign * x[k] * x[k];
+    if (d <= kSingular * rk[k] * rk[k]) return false;
+    double root = sqrt(d), c = root / rk[k], s = x[k] / rk[k];
+    rk[k] = root;
+    for (int j = k + 1; j < n; j++) {
+      rk[j] = (rk[j] + sign * s * x[j]) / c;
+      x[j] = c * x[j] - s * rk[j];
+    }
+  }
+  return true;
+}
+
+// Решение R^T Y = B, затем R X = Y; B - n x m по строкам
+void CholeskySolve(const double *r, int n, double *b, int m) {
+  for (int i = 0; i < n; i++) {
+    const double *ri = r + (size_t)i * n;
+    double *bi = b + (size_t)i * m;
+    for (int c = 0; c < m; c++) bi[c] /= ri[i];
+    for (int j = i + 1; j < n; j++) {
+      double *bj = b + (size_t)j * m;
+      for (int c = 0; c < m; c++) bj[c] -= ri[j] * bi[c];
+    }
+  }
+  for (int i = n - 1; i >= 0; i--) {
+    const double *ri = r + (size_t)i * n;
+    double *bi = b + (size_t)i * m;
+    for (int j = i + 1; j < n; j++) {
+      const double *bj = b + (size_t)j * m;
+      for (int c = 0; c < m; c++) bi[c] -= ri[j] * bj[c];
+    }
+    for (int c = 0; c < m; c++) bi[c] /= ri[i];
+  }
+}
+
+void CheckInterval(int check_interval) {
+  if (check_interval < 1)
+    throw std::out_of_range("The check interval must be positive");
+}
+
+void CheckSize(int size) {
+  if (size < 1)
+    throw std::length_error(
+        "Invalid input, matrices must have a positive size");
+}
+
+void CheckIndex(int index, int size) {
+  if (index < 0 || index >= size)
+    throw std::out_of_range("Matrix out of range");
+}
+
+}  // namespace
+
+IncrementalInverse::IncrementalInverse(const Matrix &matrix,
+                                       int check_interval, double tolerance)
+    : matrix_(matrix),
+      inverse_(matrix.InverseMatrix()),
+      check_interval_(check_interval),
+      tolerance_(tolerance) {
+  CheckInterval(check_interval);
+}
+
+int IncrementalInverse::getSize() const noexcept { return matrix_.rows_; }
+
+const Matrix &IncrementalInverse::getMatrix() const noexcept {
+  return matrix_;
+}
+
+const Matrix &IncrementalInverse::getInverse() const noexcept {
+  return inverse_;
+}
+
+int IncrementalInverse::getRefactorizations() const noexcept {
+  return refactorizations_;
+}
+
+void IncrementalInverse::setSize(const int size) {
+  CheckSize(size);
+  while (getSize() < size) {
+    Matrix column(getSize(), 1), row(1, getSize() + 1);
+    row.matrix_[0][getSize()] = 1;
+    Append(column, row);
+  }
+  while (getSize() > size) Remove(getSize() - 1);
+}
+
+void IncrementalInverse::Update(const Matrix &u, const Matrix &v) {
+  int n = getSize(), k = u.cols_;
+  if (u.rows_ != n || v.rows_ != n || v.cols_ != k)
+    throw std::out_of_range("Matrix must be the same size");
+  // W = A^-1 U, Z = V^T A^-1, C = I + V^T W;
+  // (A + U V^T)^-1 = A^-1 - W C^-1 Z
+  std::vector<double> w((size_t)n * k);
+  Matrix z(k, n), capacitance(k, k);
+  ParallelGemm(false, false, n, k, n, 1.0, inverse_.matrix_[0], n,
+               u.matrix_[0], k, w.data(), k);
+  ParallelGemm(true, false, k, n, n, 1.0, v.matrix_[0], k,
+               inverse_.matrix_[0], n, z.matrix_[0], n);
+  ParallelGemm(true, false, k, k, n, 1.0, v.matrix_[0], k, w.data(), k,
+               capacitance.matrix_[0], k);
+  // det C = det(A + U V^T) / det A. Строка i матрицы C по норме не больше
+  // 1 + |v_i| |W|, и произведение этих оценок задаёт масштаб, с которым
+  // сравнивается определитель
+  std::vector<double> v_norms(k);
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < k; j++) v_norms[j] += v.matrix_[i][j] * v.matrix_[i][j];
+  }
+  double w_norm = Norm(w.data(), n * k), bound = 1;
+  for (int j = 0; j < k; j++) {
+    capacitance.matrix_[j][j] += 1;
+    bound *= 1 + sqrt(v_norms[j]) * w_norm;
+  }
+  if (fabs(capacitance.Determinant()) <= kSingular * bound)
+    throw std::logic_error("Determinant can't be zero");
+  Matrix y = capacitance.Solve(z);
+  ParallelGemm(false, false, n, n, k, -1.0, w.data(), k, y.matrix_[0], n,
+               inverse_.matrix_[0], n);
+  ParallelGemm(false, true, n, n, k, 1.0, u.matrix_[0], k, v.matrix_[0], k,
+               matrix_.matrix_[0], n);
+  matrix_.Invalidate();
+  inverse_.Invalidate();
+  Changed();
+}
+
+void IncrementalInverse::UpdateRow(int row, const Matrix &values) {
+  int n = getSize();
+  CheckIndex(row, n);
+  if (values.rows_ != 1 || values.cols_ != n)
+    throw std::out_of_range("Matrix must be the same size");
+  Matrix u(n, 1), v(n, 1, uninitialized);
+  u.matrix_[row][0] = 1;
+  for (int j = 0; j < n; j++)
+    v.matrix_[j][0] = values.matrix_[0][j] - matrix_.matrix_[row][j];
+  Update(u, v);
+}
+
+void IncrementalInverse::UpdateColumn(int column, const Matrix &values) {
+  int n = getSize();
+  CheckIndex(column, n);
+  if (values.rows_ != n || values.cols_ != 1)
+    throw std::out_of_range("Matrix must be the same size");
+  Matrix u(n, 1, uninitialized), v(n, 1);
+  v.matrix_[column][0] = 1;
+  for (int i = 0; i < n; i++)
+    u.matrix_[i][0] = values.matrix_[i][0] - matrix_.matrix_[i][column];
+  Update(u, v);
+}
+
+void IncrementalInverse::Append(const Matrix &column, const Matrix &row) {
+  int n = getSize();
+  if (column.rows_ != n || column.cols_ != 1 || row.rows_ != 1 ||
+      row.cols_ != n + 1)
+    throw std::out_of_range("Matrix must be the same size");
+  // Окаймление: w = A^-1 c, z = r A^-1, s = d - r w (дополнение Шура)
+  const double *c = column.matrix_[0], *r = row.matrix_[0];
+  double d = r[n];
+  std::vector<double> w(n), z(n);
+  for (int i = 0; i < n; i++) {
+    const double *inverse = inverse_.matrix_[i];
+    w[i] = Dot(inverse, c, n);
+    for (int j = 0; j < n; j++) z[j] += r[i] * inverse[j];
+  }
+  double s = d - Dot(r, w.data(), n);
+  if (fabs(s) <= kSingular * (fabs(d) + Norm(r, n) * Norm(w.data(), n)))
+    throw std::logic_error("Determinant can't be zero");
+  Matrix matrix(n + 1, n + 1, uninitialized);
+  Matrix inverse(n + 1, n + 1, uninitialized);
+  for (int i = 0; i < n; i++) {
+    std::copy(matrix_.matrix_[i], matrix_.matrix_[i] + n, matrix.matrix_[i]);
+    matrix.matrix_[i][n] = c[i];
+    for (int j = 0; j < n; j++)
+      inverse.matrix_[i][j] = inverse_.matrix_[i][j] + w[i] * z[j] / s;
+    inverse.matrix_[i][n] = -w[i] / s;
+    inverse.matrix_[n][i] = -z[i] / s;
+  }
+  std::copy(r, r + n + 1, matrix.matrix_[n]);
+  inverse.matrix_[n][n] = 1 / s;
+  matrix_ = std::move(matrix);
+  inverse_ = std::move(inverse);
+  Changed();
+}
+
+void IncrementalInverse::Remove(int index) {
+  int n = getSize();
+  CheckIndex(index, n);
+  CheckSize(n - 1);
+  // (A без строки и столбца index)^-1 = B' - b_col b_row / b, где B = A^-1
+  const double *pivot_row = inverse_.matrix_[index];
+  double pivot = pivot_row[index];
+  if (fabs(pivot) <= kSingular * Norm(pivot_row, n))
+    throw std::logic_error("Determinant can't be zero");
+  Matrix matrix(n - 1, n - 1, uninitialized);
+  Matrix inverse(n - 1, n - 1, uninitialized);
+  for (int i = 0, ii = 0; i < n; i++) {
+    if (i == index) continue;
+    double factor = inverse_.matrix_[i][index] / pivot;
+    for (int j = 0, jj = 0; j < n; j++) {
+      if (j == index) continue;
+      matrix.matrix_[ii][jj] = matrix_.matrix_[i][j];
+      inverse.matrix_[ii][jj] = inverse_.matrix_[i][j] - factor * pivot_row[j];
+      jj++;
+    }
+    ii++;
+  }
+  matrix_ = std::move(matrix);
+  inverse_ = std::move(inverse);
+  Changed();
+}
+
+Matrix IncrementalInverse::Solve(const Matrix &other) const {
+  if (other.rows_ != getSize())
+    throw std::out_of_range(
+        "The number of rows of the right-hand side is not equal to the size "
+        "of the matrix");
+  return inverse_ * other;
+}
+
+void IncrementalInverse::Changed() {
+  if (++changes_ % check_interval_) return;
+  int n = getSize();
+  std::vector<double> x = Probe(n), y(n);
+  for (int i = 0; i < n; i++) y[i] = Dot(inverse_.matrix_[i], x.data(), n);
+  if (BackwardError(matrix_.matrix_[0], n, x, y) > tolerance_) Refactor();
+}
+
+void IncrementalInverse::Refactor() {
+  inverse_ = matrix_.InverseMatrix();
+  refactorizations_++;
+}
+
+CholeskyFactor::CholeskyFactor(const Matrix &matrix, int check_interval,
+                               double tolerance)
+    : matrix_(matrix), check_interval_(check_interval), tolerance_(tolerance) {
+  CheckInterval(check_interval);
+  if (matrix.rows_ != matrix.cols_)
+    throw std::logic_error("The matrix is not square");
+  if (!(matrix == matrix.Transpose()))
+    throw std::logic_error("The matrix is not symmetric");
+  Refactor();
+  refactorizations_ = 0;
+}
+
+int CholeskyFactor::getSize() const noexcept { return matrix_.rows_; }
+
+const Matrix &CholeskyFactor::getMatrix() const noexcept { return matrix_; }
+
+Matrix CholeskyFactor::getFactor() const { return upper_.Transpose(); }
+
+int CholeskyFactor::getRefactorizations() const noexcept {
+  return refactorizations_;
+}
+
+void CholeskyFactor::setSize(const int size) {
+  CheckSize(size);
+  while (getSize() < size) {
+    Matrix column(getSize() + 1, 1);
+    column.matrix_[getSize()][0] = 1;
+    Append(column);
+  }
+  while (getSize() > size) Remove(getSize() - 1);
+}
+
+void CholeskyFactor::Update(const Matrix &x) {
+  int n = getSize();
+  if (x.rows_ != n || x.cols_ != 1)
+    throw std::out_of_range("Matrix must be the same size");
+  std::vector<double> work(x.matrix_[0], x.matrix_[0] + n);
+  RankOneUpdate(upper_.matrix_[0], n, n, work.data(), 1.0);
+  ParallelGemm(false, true, n, n, 1, 1.0, x.matrix_[0], 1, x.matrix_[0], 1,
+               matrix_.matrix_[0], n);
+  matrix_.Invalidate();
+  upper_.Invalidate();
+  Changed();
+}
+
+void CholeskyFactor::Downdate(const Matrix &x) {
+  int n = getSize();
+  if (x.rows_ != n || x.cols_ != 1)
+    throw std::out_of_range("Matrix must be the same size");
+  std::vector<double> work(x.matrix_[0], x.matrix_[0] + n);
+  // Неудачное понижение не должно портить разложение
+  Matrix upper(upper_);
+  if (!RankOneUpdate(upper.matrix_[0], n, n, work.data(), -1.0))
+    throw std::logic_error("The matrix is not positive definite");
+  upper_ = std::move(upper);
+  ParallelGemm(false, true, n, n, 1, -1.0, x.matrix_[0], 1, x.matrix_[0], 1,
+               matrix_.matrix_[0], n);
+  matrix_.Invalidate();
+  Changed();
+}
+
+void CholeskyFactor::Append(const Matrix &column) {
+  int n = getSize();
+  if (column.rows_ != n + 1 || column.cols_ != 1)
+    throw std::out_of_range("Matrix must be the same size");
+  // Новый столбец R: R^T w = b, последний диагональный элемент
+  // sqrt(d - w^T w)
+  const double *b = column.matrix_[0];
+  std::vector<double> w(b, b + n);
+  for (int i = 0; i < n; i++) {
+    const double *ri = upper_.matrix_[i];
+    w[i] /= ri[i];
+    for (int j = i + 1; j < n; j++) w[j] -= ri[j] * w[i];
+  }
+  double d = b[n], square = d - Dot(w.data(), w.data(), n);
+  if (square <= kSingular * fabs(d))
+    throw std::logic_error("The matrix is not positive definite");
+  Matrix matrix(n + 1, n + 1, uninitialized), upper(n + 1, n + 1);
+  for (int i = 0; i < n; i++) {
+    std::copy(matrix_.matrix_[i], matrix_.matrix_[i] + n, matrix.matrix_[i]);
+    std::copy(upper_.matrix_[i], upper_.matrix_[i] + n, upper.matrix_[i]);
+    matrix.matrix_[i][n] = matrix.matrix_[n][i] = b[i];
+    upper.matrix_[i][n] = w[i];
+  }
+  matrix.matrix_[n][n] = d;
+  upper.matrix_[n][n] = sqrt(square);
+  matrix_ = std::move(matrix);
+  upper_ = std::move(upper);
+  Changed();
+}
+
+void CholeskyFactor::Remove(int index) {
+  int n = getSize();
+  CheckIndex(index, n);
+  CheckSize(n - 1);
+  // Без строки index правый нижний блок R33 меняется на разложение
+  // R33^T R33 + r23 r23^T, где r23 - остаток строки index
+  Matrix matrix(n - 1, n - 1, uninitialized);
+  Matrix upper(n - 1, n - 1, uninitialized);
+  for (int i = 0, ii = 0; i < n; i++) {
+    if (i == index) continue;
+    for (int j = 0, jj = 0; j < n; j++) {
+      if (j == index) continue;
+      matrix.matrix_[ii][jj] = matrix_.matrix_[i][j];
+      upper.matrix_[ii][jj] = upper_.matrix_[i][j];
+      jj++;
+    }
+    ii++;
+  }
+  std::vector<double> row(upper_.matrix_[index] + index + 1,
+                          upper_.matrix_[index] + n);
+  if (index < n - 1)
+    RankOneUpdate(upper.matrix_[index] + index, n - 1 - index, n - 1,
+                  row.data(), 1.0);
+  matrix_ = std::move(matrix);
+  upper_ = std::move(upper);
+  Changed();
+}
+
+Matrix CholeskyFactor::Solve(const Matrix &other) const {
+  if (other.rows_ != getSize())
+    throw std::out_of_range(
+        "The number of rows of the right-hand side is not equal to the size "
+        "of the matrix");
+  Matrix result(other);
+  CholeskySolve(upper_.matrix_[0], getSize(), result.matrix_[0],
+                result.cols_);
+  return result;
+}
+
+void CholeskyFactor::Changed() {
+  if (++changes_ % check_interval_) return;
+  int n = getSize();
+  std::vector<double> x = Probe(n), y(x);
+  CholeskySolve(upper_.matrix_[0], n, y.data(), 1);
+  if (BackwardError(matrix_.matrix_[0], n, x, y) > tolerance_) Refactor();
+}
+
+void CholeskyFactor::Refactor() {
+  Matrix upper(matrix_);
+  if (!Cholesky(upper.matrix_[0], getSize()))
+    throw std::logic_error("The matrix is not positive definite");
+  upper_ = std::move(upper);
+  refactorizations_++;
+}
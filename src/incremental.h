@@ -0,0 +1,75 @@
+#ifndef MATRIX_INCREMENTAL_H_
+#define MATRIX_INCREMENTAL_H_
+
+#include "matrix.h"
+
+// Обратная матрица, которая поддерживается при малых изменениях исходной
+// за O(n^2) на изменение ранга 1 (формула Шермана-Моррисона-Вудбери,
+// окаймление при добавлении строки и столбца). Погрешность накапливается,
+// поэтому каждые check_interval изменений невязка проверяется на пробном
+// векторе, и при превышении tolerance обратная считается заново.
+class IncrementalInverse {
+ public:
+  explicit IncrementalInverse(const Matrix &matrix, int check_interval = 32,
+                              double tolerance = 1e-10);
+
+  int getSize() const noexcept;
+  const Matrix &getMatrix() const noexcept;
+  const Matrix &getInverse() const noexcept;
+  int getRefactorizations() const noexcept;
+  // Размер меняется как в setRows/setCols: новые строки и столбцы
+  // добавляются как у единичной матрицы, лишние удаляются с конца
+  void setSize(const int size);
+
+  // A += U * V^T, U и V - n x k
+  void Update(const Matrix &u, const Matrix &v);
+  // Замена строки (1 x n) или столбца (n x 1)
+  void UpdateRow(int row, const Matrix &values);
+  void UpdateColumn(int column, const Matrix &values);
+  // Новый последний столбец column (n x 1) и строка row (1 x (n + 1))
+  void Append(const Matrix &column, const Matrix &row);
+  // Удаление строки и столбца index
+  void Remove(int index);
+  Matrix Solve(const Matrix &other) const;
+
+ private:
+  void Changed();
+  void Refactor();
+
+  Matrix matrix_, inverse_;
+  int check_interval_, changes_ = 0, refactorizations_ = 0;
+  double tolerance_;
+};
+
+// Разложение Холецкого A = L * L^T симметричной положительно определённой
+// матрицы с обновлениями ранга 1 за O(n^2) и той же проверкой точности
+class CholeskyFactor {
+ public:
+  explicit CholeskyFactor(const Matrix &matrix, int check_interval = 32,
+                          double tolerance = 1e-10);
+
+  int getSize() const noexcept;
+  const Matrix &getMatrix() const noexcept;
+  Matrix getFactor() const;
+  int getRefactorizations() const noexcept;
+  void setSize(const int size);
+
+  // A += x * x^T и A -= x * x^T, x - n x 1
+  void Update(const Matrix &x);
+  void Downdate(const Matrix &x);
+  // Новые последние строка и столбец, column - (n + 1) x 1
+  void Append(const Matrix &column);
+  void Remove(int index);
+  Matrix Solve(const Matrix &other) const;
+
+ private:
+  void Changed();
+  void Refactor();
+
+  // Хранится R = L^T: столбцы L - строки R, и проходы идут по памяти подряд
+  Matrix matrix_, upper_;
+  int check_interval_, changes_ = 0, refactorizations_ = 0;
+  double tolerance_;
+};
+
+#endif  // MATRIX_INCREMENTAL_H_
@@ -0,0 +1,138 @@
+#ifndef MATRIX_KERNELS_H_
+#define MATRIX_KERNELS_H_
+
+#include <algorithm>
+
+#include "executor.h"
+
+// Внутренние вычислительные ядра библиотеки. Все матрицы хранятся по
+// строкам, ld - расстояние между началами соседних строк.
+namespace kernels {
+
+const int kGemmColumns = 512;
+const int kGemmDepth = 256;
+const int kGemmDotColumns = 64;
+// Меньшие произведения (в умножениях-сложениях) считаются в одном потоке
+const double kParallelGemmWork = 1 << 21;
+
+// Скалярное произведение с несколькими аккумуляторами, чтобы компилятор
+// мог векторизовать цикл без -ffast-math
+template <typename T>
+T Dot(const T *x, const T *y, int length) {
+  T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  int k = 0;
+  for (; k + 4 <= length; k += 4) {
+    s0 += x[k] * y[k];
+    s1 += x[k + 1] * y[k + 1];
+    s2 += x[k + 2] * y[k + 2];
+    s3 += x[k + 3] * y[k + 3];
+  }
+  for (; k < length; k++) s0 += x[k] * y[k];
+  return (s0 + s1) + (s2 + s3);
+}
+
+// C += alpha * op(A) * op(B), op(A) - m x k, op(B) - k x n, C - m x n.
+// При transpose_a хранится A^T (k x m), при transpose_b - B^T (n x k).
+// Без transpose_b блоки B размером kGemmDepth x kGemmColumns держатся в
+// кэше, и четыре строки C обновляются за один проход по строке B; с
+// transpose_b элементы C - скалярные произведения строк.
+template <typename T>
+void Gemm(bool transpose_a, bool transpose_b, int m, int n, int k, T alpha,
+          const T *a, int lda, const T *b, int ldb, T *c, int ldc) {
+  // A(i, r) = a[i * a_row + r * a_column]
+  const size_t a_row = transpose_a ? 1 : lda, a_column = transpose_a ? lda : 1;
+  if (transpose_b && !transpose_a) {
+    for (int kk = 0; kk < k; kk += kGemmDepth) {
+      int depth = std::min(kGemmDepth, k - kk);
+      for (int jj = 0; jj < n; jj += kGemmDotColumns) {
+        int columns = std::min(kGemmDotColumns, n - jj);
+        for (int i = 0; i < m; i++) {
+          const T *ai = a + (size_t)i * lda + kk;
+          T *ci = c + (size_t)i * ldc + jj;
+          for (int j = 0; j < columns; j++) {
+            ci[j] += alpha * Dot(ai, b + (size_t)(jj + j) * ldb + kk, depth);
+          }
+        }
+      }
+    }
+    return;
+  }
+  // B(r, j) = b[r * b_row + j * b_column]
+  const size_t b_row = transpose_b ? 1 : ldb, b_column = transpose_b ? ldb : 1;
+  for (int jj = 0; jj < n; jj += kGemmColumns) {
+    int columns = std::min(kGemmColumns, n - jj);
+    for (int kk = 0; kk < k; kk += kGemmDepth) {
+      int depth = std::min(kGemmDepth, k - kk);
+      int i = 0;
+      for (; i + 4 <= m; i += 4) {
+        T *__restrict__ c0 = c + (size_t)i * ldc + jj;
+        T *__restrict__ c1 = c0 + ldc;
+        T *__restrict__ c2 = c1 + ldc;
+        T *__restrict__ c3 = c2 + ldc;
+        const T *a0 = a + i * a_row + kk * a_column;
+        for (int r = 0; r < depth; r++) {
+          const T *ar = a0 + r * a_column;
+          T x0 = alpha * ar[0], x1 = alpha * ar[a_row];
+          T x2 = alpha * ar[2 * a_row], x3 = alpha * ar[3 * a_row];
+          const T *__restrict__ br = b + (kk + r) * b_row + jj * b_column;
+          if (b_column == 1) {
+            for (int j = 0; j < columns; j++) {
+              T y = br[j];
+              c0[j] += x0 * y;
+              c1[j] += x1 * y;
+              c2[j] += x2 * y;
+              c3[j] += x3 * y;
+            }
+          } else {
+            for (int j = 0; j < columns; j++) {
+              T y = br[j * b_column];
+              c0[j] += x0 * y;
+              c1[j] += x1 * y;
+              c2[j] += x2 * y;
+              c3[j] += x3 * y;
+            }
+          }
+        }
+      }
+      for (; i < m; i++) {
+        T *__restrict__ ci = c + (size_t)i * ldc + jj;
+        const T *ai = a + i * a_row + kk * a_column;
+        for (int r = 0; r < depth; r++) {
+          T x = alpha * ai[r * a_column];
+          const T *__restrict__ br = b + (kk + r) * b_row + jj * b_column;
+          for (int j = 0; j < columns; j++) ci[j] += x * br[j * b_column];
+        }
+      }
+    }
+  }
+}
+
+// Длина отрезка строк, на которые ParallelGemm делит C (по четыре отрезка
+// на поток, кратно высоте блока ядра)
+inline int RowGrain(int rows) {
+  int threads = Executor::Instance().getThreadCount();
+  return std::max(4, (rows + 4 * threads - 1) / (4 * threads) / 4 * 4);
+}
+
+// Gemm, распределённый по строкам C между потоками пула; cancellable - как
+// в Executor::ParallelFor
+template <typename T>
+void ParallelGemm(bool transpose_a, bool transpose_b, int m, int n, int k,
+                  T alpha, const T *a, int lda, const T *b, int ldb, T *c,
+                  int ldc, bool cancellable = false) {
+  Executor &executor = Executor::Instance();
+  int threads = executor.getThreadCount();
+  if (threads == 1 || (double)m * n * k < kParallelGemmWork) {
+    Gemm(transpose_a, transpose_b, m, n, k, alpha, a, lda, b, ldb, c, ldc);
+    return;
+  }
+  executor.ParallelFor(0, m, RowGrain(m), [=](int begin, int end) {
+    Gemm(transpose_a, transpose_b, end - begin, n, k, alpha,
+         a + (transpose_a ? (size_t)begin : (size_t)begin * lda), lda, b,
+         ldb, c + (size_t)begin * ldc, ldc);
+  }, cancellable);
+}
+
+}  // namespace kernels
+
+#endif  // MATRIX_KERNELS_H_
@@ -0,0 +1,386 @@
+#include "lazy_matrix.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "executor.h"
+#include "kernels.h"
+
+namespace {
+
+const int kCombineTile = 64;
+
+}  // namespace
+
+struct LazyMatrix::Node {
+  enum class Op { kLeaf, kAdd, kSub, kScale, kTranspose, kMul };
+  Op op;
+  int rows, cols;
+  double scalar;
+  std::shared_ptr<const Node> left, right;
+  std::shared_ptr<const Matrix> owned;
+  const Matrix *leaf;
+};
+
+// Вычисление графа. Каждый узел после нумерации значений (одинаковые
+// подвыражения получают один номер) описывается линейной комбинацией
+// хранимых буферов: листьев (исходных матриц) и произведений. Всё, кроме
+// произведений, вычисляется одним поэлементным проходом по этой
+// комбинации. Операнд умножения, который сводится к одному слагаемому,
+// передаётся в Gemm как есть (с транспонированием и множителем), иначе
+// комбинация материализуется в отдельный буфер.
+class LazyMatrix::Evaluator {
+ public:
+  explicit Evaluator(EvaluationInfo *info) : info_(info) {}
+  Matrix Run(const Node *root);
+
+ private:
+  // coefficient * S или coefficient * S^T, где S - буфер значения base
+  struct Term {
+    int base;
+    bool transposed;
+    double coefficient;
+  };
+  enum class Kind { kLeaf, kProduct, kCombination, kExpression };
+  struct Value {
+    Kind kind;
+    // Размеры хранимого буфера (для kExpression - логические)
+    int rows, cols;
+    std::vector<Term> terms;
+    Term a, b;
+    double alpha;
+    int uses;
+    const double *data;
+    std::vector<double> buffer;
+  };
+
+  int Number(const Node *node);
+  int AddValue(Kind kind, int rows, int cols, std::vector<Term> terms);
+  Term Operand(int id);
+  void Schedule(int id, std::vector<bool> &visited, std::vector<int> &order);
+  void Use(int id);
+  void Release(int id);
+  double *Acquire(int id);
+  void Combine(const std::vector<Term> &terms, double *output, int rows,
+               int cols) const;
+  static std::vector<Term> Merge(std::vector<Term> terms);
+
+  EvaluationInfo *info_;
+  std::vector<Value> values_;
+  std::map<const Node *, int> numbers_;
+  std::map<std::tuple<int, const void *, uint64_t, int, int>, int> keys_;
+  std::map<int, int> combinations_;
+  std::multimap<size_t, std::vector<double>> pool_;
+};
+
+std::vector<LazyMatrix::Evaluator::Term> LazyMatrix::Evaluator::Merge(
+    std::vector<Term> terms) {
+  std::vector<Term> result;
+  for (const Term &term : terms) {
+    auto same = std::find_if(result.begin(), result.end(), [&](const Term &x) {
+      return x.base == term.base && x.transposed == term.transposed;
+    });
+    if (same == result.end()) {
+      result.push_back(term);
+    } else {
+      same->coefficient += term.coefficient;
+    }
+  }
+  result.erase(std::remove_if(result.begin(), result.end(),
+                              [](const Term &x) { return x.coefficient == 0; }),
+               result.end());
+  return result;
+}
+
+int LazyMatrix::Evaluator::AddValue(Kind kind, int rows, int cols,
+                                    std::vector<Term> terms) {
+  values_.push_back(Value{kind, rows, cols, std::move(terms), Term{}, Term{},
+                          1.0, 0, nullptr, {}});
+  return (int)values_.size() - 1;
+}
+
+int LazyMatrix::Evaluator::Number(const Node *node) {
+  auto known = numbers_.find(node);
+  if (known != numbers_.end()) return known->second;
+  int left = node->left ? Number(node->left.get()) : -1;
+  int right = node->right ? Number(node->right.get()) : -1;
+  if (node->op == Node::Op::kAdd && left > right) std::swap(left, right);
+  uint64_t scalar;
+  memcpy(&scalar, &node->scalar, sizeof(scalar));
+  auto key = std::make_tuple((int)node->op, (const void *)node->leaf, scalar,
+                             left, right);
+  auto same = keys_.find(key);
+  if (same != keys_.end()) return numbers_[node] = same->second;
+
+  int id;
+  switch (node->op) {
+    case Node::Op::kLeaf:
+      id = AddValue(Kind::kLeaf, node->rows, node->cols, {});
+      values_[id].data = node->leaf->matrix_[0];
+      values_[id].terms = {Term{id, false, 1.0}};
+      break;
+    case Node::Op::kMul: {
+      Term a = Operand(left), b = Operand(right);
+      // A^T * B^T = (B * A)^T: произведение хранится транспонированным
+      bool transposed = a.transposed && b.transposed;
+      if (transposed) {
+        std::swap(a, b);
+        a.transposed = b.transposed = false;
+      }
+      id = transposed ? AddValue(Kind::kProduct, node->cols, node->rows, {})
+                      : AddValue(Kind::kProduct, node->rows, node->cols, {});
+      Value &product = values_[id];
+      product.a = a;
+      product.b = b;
+      product.alpha = a.coefficient * b.coefficient;
+      product.terms = {Term{id, transposed, 1.0}};
+      break;
+    }
+    default: {
+      std::vector<Term> terms = values_[left].terms;
+      if (node->op == Node::Op::kAdd || node->op == Node::Op::kSub) {
+        double sign = node->op == Node::Op::kAdd ? 1.0 : -1.0;
+        for (Term term : values_[right].terms) {
+          term.coefficient *= sign;
+          terms.push_back(term);
+        }
+      } else if (node->op == Node::Op::kScale) {
+        for (Term &term : terms) term.coefficient *= node->scalar;
+      } else {
+        for (Term &term : terms) term.transposed = !term.transposed;
+      }
+      id = AddValue(Kind::kExpression, node->rows, node->cols,
+                    Merge(std::move(terms)));
+    }
+  }
+  keys_[key] = id;
+  return numbers_[node] = id;
+}
+
+LazyMatrix::Evaluator::Term LazyMatrix::Evaluator::Operand(int id) {
+  if (values_[id].terms.size() == 1) return values_[id].terms[0];
+  auto known = combinations_.find(id);
+  if (known != combinations_.end()) return Term{known->second, false, 1.0};
+  int combination = AddValue(Kind::kCombination, values_[id].rows,
+                             values_[id].cols, values_[id].terms);
+  values_[combination].terms = values_[id].terms;
+  combinations_[id] = combination;
+  return Term{combination, false, 1.0};
+}
+
+void LazyMatrix::Evaluator::Schedule(int id, std::vector<bool> &visited,
+                                     std::vector<int> &order) {
+  if (visited[id]) return;
+  visited[id] = true;
+  const Value &value = values_[id];
+  if (value.kind == Kind::kProduct) {
+    Schedule(value.a.base, visited, order);
+    Schedule(value.b.base, visited, order);
+    Use(value.a.base);
+    Use(value.b.base);
+  } else if (value.kind == Kind::kCombination) {
+    for (const Term &term : value.terms) {
+      Schedule(term.base, visited, order);
+      Use(term.base);
+    }
+  }
+  order.push_back(id);
+}
+
+void LazyMatrix::Evaluator::Use(int id) { values_[id].uses++; }
+
+void LazyMatrix::Evaluator::Release(int id) {
+  Value &value = values_[id];
+  if (--value.uses == 0 && !value.buffer.empty()) {
+    pool_.emplace(value.buffer.size(), std::move(value.buffer));
+    value.buffer.clear();
+  }
+}
+
+double *LazyMatrix::Evaluator::Acquire(int id) {
+  Value &value = values_[id];
+  size_t size = (size_t)value.rows * value.cols;
+  auto free = pool_.find(size);
+  if (free != pool_.end()) {
+    value.buffer = std::move(free->second);
+    pool_.erase(free);
+  } else {
+    value.buffer.resize(size);
+    info_->allocations++;
+  }
+  value.data = value.buffer.data();
+  return value.buffer.data();
+}
+
+void LazyMatrix::Evaluator::Combine(const std::vector<Term> &terms,
+                                    double *output, int rows,
+                                    int cols) const {
+  info_->passes++;
+  // Обход плитками, чтобы чтение транспонированных слагаемых оставалось в
+  // кэше; каждая плитка результата пишется один раз на слагаемое
+  auto tiles = [&](int begin, int end) {
+    for (int i0 = begin * kCombineTile; i0 < std::min(rows, end * kCombineTile);
+         i0 += kCombineTile) {
+      int i1 = std::min(rows, i0 + kCombineTile);
+      for (int j0 = 0; j0 < cols; j0 += kCombineTile) {
+        int j1 = std::min(cols, j0 + kCombineTile);
+        if (terms.empty()) {
+          for (int i = i0; i < i1; i++)
+            std::fill(output + (size_t)i * cols + j0,
+                      output + (size_t)i * cols + j1, 0.0);
+        }
+        for (size_t t = 0; t < terms.size(); t++) {
+          const double *source = values_[terms[t].base].data;
+          size_t ld = values_[terms[t].base].cols;
+          double c = terms[t].coefficient;
+          for (int i = i0; i < i1; i++) {
+            double *o = output + (size_t)i * cols;
+            if (!terms[t].transposed) {
+              const double *s = source + i * ld;
+              if (t == 0) {
+                for (int j = j0; j < j1; j++) o[j] = c * s[j];
+              } else {
+                for (int j = j0; j < j1; j++) o[j] += c * s[j];
+              }
+            } else {
+              const double *s = source + i;
+              if (t == 0) {
+                for (int j = j0; j < j1; j++) o[j] = c * s[j * ld];
+              } else {
+                for (int j = j0; j < j1; j++) o[j] += c * s[j * ld];
+              }
+            }
+          }
+        }
+      }
+    }
+  };
+  Executor &executor = Executor::Instance();
+  int count = (rows + kCombineTile - 1) / kCombineTile;
+  executor.ParallelFor(0, count,
+                       std::max(1, count / (2 * executor.getThreadCount())),
+                       tiles);
+}
+
+Matrix LazyMatrix::Evaluator::Run(const Node *root) {
+  int top = Number(root);
+  std::vector<Term> output = values_[top].terms;
+  // Произведение, которое и есть результат, пишется прямо в него
+  int direct = -1;
+  if (output.size() == 1 && !output[0].transposed &&
+      output[0].coefficient == 1.0 &&
+      values_[output[0].base].kind == Kind::kProduct)
+    direct = output[0].base;
+
+  std::vector<bool> visited(values_.size());
+  std::vector<int> order;
+  for (const Term &term : output) {
+    Schedule(term.base, visited, order);
+    if (term.base != direct) Use(term.base);
+  }
+
+  // Нули нужны, только если в результат сразу пишет Gemm
+  Matrix result = direct >= 0
+                      ? Matrix(root->rows, root->cols)
+                      : Matrix(root->rows, root->cols, uninitialized);
+  for (int id : order) {
+    Value &value = values_[id];
+    if (value.kind == Kind::kProduct) {
+      double *target = id == direct ? result.matrix_[0] : Acquire(id);
+      if (id != direct)
+        std::fill(target, target + (size_t)value.rows * value.cols, 0.0);
+      const Value &a = values_[value.a.base], &b = values_[value.b.base];
+      int depth = value.a.transposed ? a.rows : a.cols;
+      kernels::ParallelGemm(value.a.transposed, value.b.transposed,
+                            value.rows, value.cols, depth, value.alpha, a.data,
+                            a.cols, b.data, b.cols, target, value.cols);
+      info_->products++;
+      Release(value.a.base);
+      Release(value.b.base);
+    } else if (value.kind == Kind::kCombination) {
+      Combine(value.terms, Acquire(id), value.rows, value.cols);
+      for (const Term &term : value.terms) Release(term.base);
+    }
+  }
+  if (direct < 0) {
+    Combine(output, result.matrix_[0], result.rows_, result.cols_);
+    for (const Term &term : output) Release(term.base);
+  }
+  return result;
+}
+
+LazyMatrix::LazyMatrix(const Matrix &matrix)
+    : node_(std::make_shared<const Node>(
+          Node{Node::Op::kLeaf, matrix.rows_, matrix.cols_, 0.0, nullptr,
+               nullptr, nullptr, &matrix})) {
+  if (matrix.rows_ < 1 || matrix.cols_ < 1)
+    throw std::length_error(
+        "Invalid input, matrices must have a positive size");
+}
+
+LazyMatrix::LazyMatrix(Matrix &&matrix) {
+  if (matrix.rows_ < 1 || matrix.cols_ < 1)
+    throw std::length_error(
+        "Invalid input, matrices must have a positive size");
+  auto owned = std::make_shared<const Matrix>(std::move(matrix));
+  node_ = std::make_shared<const Node>(Node{Node::Op::kLeaf, owned->rows_,
+                                            owned->cols_, 0.0, nullptr,
+                                            nullptr, owned, owned.get()});
+}
+
+LazyMatrix::LazyMatrix(std::shared_ptr<const Node> node)
+    : node_(std::move(node)) {}
+
+int LazyMatrix::getRows() const noexcept { return node_->rows; }
+
+int LazyMatrix::getCols() const noexcept { return node_->cols; }
+
+LazyMatrix LazyMatrix::operator+(const LazyMatrix &other) const {
+  if (getCols() != other.getCols() || getRows() != other.getRows())
+    throw std::out_of_range("Matrix must be the same size");
+  return LazyMatrix(std::make_shared<const Node>(
+      Node{Node::Op::kAdd, getRows(), getCols(), 0.0, node_, other.node_,
+           nullptr, nullptr}));
+}
+
+LazyMatrix LazyMatrix::operator-(const LazyMatrix &other) const {
+  if (getCols() != other.getCols() || getRows() != other.getRows())
+    throw std::out_of_range("Matrix must be the same size");
+  return LazyMatrix(std::make_shared<const Node>(
+      Node{Node::Op::kSub, getRows(), getCols(), 0.0, node_, other.node_,
+           nullptr, nullptr}));
+}
+
+LazyMatrix LazyMatrix::operator*(const LazyMatrix &other) const {
+  if (getCols() != other.getRows())
+    throw std::out_of_range(
+        "The number of columns of the first matrix is not equal to the "
+        "number of rows of the second matrix");
+  return LazyMatrix(std::make_shared<const Node>(
+      Node{Node::Op::kMul, getRows(), other.getCols(), 0.0, node_,
+           other.node_, nullptr, nullptr}));
+}
+
+LazyMatrix LazyMatrix::operator*(const double num) const {
+  return LazyMatrix(std::make_shared<const Node>(Node{
+      Node::Op::kScale, getRows(), getCols(), num, node_, nullptr, nullptr,
+      nullptr}));
+}
+
+LazyMatrix LazyMatrix::Transpose() const {
+  return LazyMatrix(std::make_shared<const Node>(
+      Node{Node::Op::kTranspose, getCols(), getRows(), 0.0, node_, nullptr,
+           nullptr, nullptr}));
+}
+
+Matrix LazyMatrix::Evaluate(EvaluationInfo *info) const {
+  EvaluationInfo local;
+  Evaluator evaluator(info ? info : &local);
+  if (info) *info = EvaluationInfo();
+  return evaluator.Run(node_.get());
+}
@@ -0,0 +1,47 @@
+#ifndef MATRIX_LAZY_MATRIX_H_
+#define MATRIX_LAZY_MATRIX_H_
+
+#include <memory>
+
+#include "matrix.h"
+
+struct EvaluationInfo {
+  int products = 0;
+  int passes = 0;
+  int allocations = 0;
+};
+
+// Отложенное вычисление: операции записываются в граф и выполняются только
+// в Evaluate(). При этом поэлементные операции (+, -, умножение на число,
+// транспонирование) сливаются в один проход, транспонирования и множители
+// операндов умножения передаются в Gemm, одинаковые подвыражения считаются
+// один раз, а промежуточные буферы переиспользуются, как только у них не
+// остаётся потребителей.
+class LazyMatrix {
+ public:
+  // Ссылается на matrix: она должна жить и не меняться до Evaluate()
+  LazyMatrix(const Matrix &matrix);
+  // Забирает временную матрицу себе
+  LazyMatrix(Matrix &&matrix);
+
+  int getRows() const noexcept;
+  int getCols() const noexcept;
+
+  LazyMatrix operator+(const LazyMatrix &other) const;
+  LazyMatrix operator-(const LazyMatrix &other) const;
+  LazyMatrix operator*(const LazyMatrix &other) const;
+  LazyMatrix operator*(const double num) const;
+  LazyMatrix Transpose() const;
+
+  Matrix Evaluate(EvaluationInfo *info = nullptr) const;
+
+ private:
+  struct Node;
+  class Evaluator;
+
+  explicit LazyMatrix(std::shared_ptr<const Node> node);
+
+  std::shared_ptr<const Node> node_;
+};
+
+#endif  // MATRIX_LAZY_MATRIX_H_
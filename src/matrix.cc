@@ -1,8 +1,542 @@
 #include "matrix.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "executor.h"
+#include "kernels.h"
+#include "storage.h"
+
+namespace {
+
+using kernels::Dot;
+using kernels::Gemm;
+using kernels::ParallelGemm;
+
+const double kEpsilon = std::numeric_limits<double>::epsilon();
+const double kEqualityTolerance = 1e-7;
+// Состояния отпечатка матрицы
+const int kFingerprintEmpty = 0;
+const int kFingerprintComputing = 1;
+const int kFingerprintReady = 2;
+// Через operator() выдана ссылка на элемент: отпечаток не хранится
+const int kFingerprintEscaped = 3;
+const int kMaxQlIterations = 60;
+const int kMaxJacobiSweeps = 75;
+const int kMaxRefinementIterations = 30;
+const int kLuBlock = 128;
+
+// Аппроксимации Паде порядка 3, 5, 7, 9, 13 для exp и границы 1-нормы, до
+// которых они дают двойную точность (Higham, 2005)
+const int kPadeOrders[] = {3, 5, 7, 9, 13};
+const double kPadeThetas[] = {1.495585217958292e-2, 2.539398330063230e-1,
+                              9.504178996162932e-1, 2.097847961257068e0,
+                              5.371920351148152e0};
+const double kPadeCoefficients[][14] = {
+    {120, 60, 12, 1},
+    {30240, 15120, 3360, 420, 30, 1},
+    {17297280, 8648640, 1995840, 277200, 25200, 1512, 56, 1},
+    {17643225600, 8821612800, 2075673600, 302702400, 30270240, 2162160,
+     110880, 3960, 90, 1},
+    {64764752532480000, 32382376266240000, 7771770303897600,
+     1187353796428800, 129060195264000, 10559470521600, 670442572800,
+     33522128640, 1323241920, 40840800, 960960, 16380, 182, 1},
+};
+
+// Приведение симметричной матрицы z (n x n, по строкам) к трёхдиагональному
+// виду отражениями Хаусхолдера. d - диагональ, e[i] - элемент (i, i - 1).
+// При accumulate в z остаётся накопленное ортогональное преобразование.
+void Tridiagonalize(double *z, int n, double *d, double *e, bool accumulate) {
+  for (int i = n - 1; i > 0; i--) {
+    int l = i - 1;
+    double h = 0, scale = 0;
+    if (l > 0) {
+      for (int k = 0; k < i; k++) scale += fabs(z[i * n + k]);
+      if (scale == 0.0) {
+        e[i] = z[i * n + l];
+      } else {
+        for (int k = 0; k < i; k++) {
+          z[i * n + k] /= scale;
+          h += z[i * n + k] * z[i * n + k];
+        }
+        double f = z[i * n + l];
+        double g = f >= 0.0 ? -sqrt(h) : sqrt(h);
+        e[i] = scale * g;
+        h -= f * g;
+        z[i * n + l] = f - g;
+        f = 0.0;
+        for (int j = 0; j < i; j++) {
+          if (accumulate) z[j * n + i] = z[i * n + j] / h;
+          g = 0.0;
+          for (int k = 0; k < j + 1; k++) g += z[j * n + k] * z[i * n + k];
+          for (int k = j + 1; k < i; k++) g += z[k * n + j] * z[i * n + k];
+          e[j] = g / h;
+          f += e[j] * z[i * n + j];
+        }
+        double hh = f / (h + h);
+        for (int j = 0; j < i; j++) {
+          f = z[i * n + j];
+          e[j] = g = e[j] - hh * f;
+          for (int k = 0; k < j + 1; k++)
+            z[j * n + k] -= f * e[k] + g * z[i * n + k];
+        }
+      }
+    } else {
+      e[i] = z[i * n + l];
+    }
+    d[i] = h;
+  }
+  d[0] = 0.0;
+  e[0] = 0.0;
+  for (int i = 0; i < n; i++) {
+    if (accumulate) {
+      if (d[i] != 0.0) {
+        for (int j = 0; j < i; j++) {
+          double g = 0.0;
+          for (int k = 0; k < i; k++) g += z[i * n + k] * z[k * n + j];
+          for (int k = 0; k < i; k++) z[k * n + j] -= g * z[k * n + i];
+        }
+      }
+      d[i] = z[i * n + i];
+      z[i * n + i] = 1.0;
+      for (int j = 0; j < i; j++) z[j * n + i] = z[i * n + j] = 0.0;
+    } else {
+      d[i] = z[i * n + i];
+    }
+  }
+}
+
+// Неявный QL-алгоритм со сдвигами для трёхдиагональной матрицы.
+// Векторы хранятся по строкам (zt - транспонированная матрица
+// преобразования), чтобы вращения шли по непрерывной памяти.
+void TridiagonalQl(double *d, double *e, int n, double *zt) {
+  for (int i = 1; i < n; i++) e[i - 1] = e[i];
+  e[n - 1] = 0.0;
+  for (int l = 0; l < n; l++) {
+    int iter = 0;
+    int m;
+    do {
+      for (m = l; m < n - 1; m++) {
+        double dd = fabs(d[m]) + fabs(d[m + 1]);
+        if (fabs(e[m]) <= kEpsilon * dd) break;
+      }
+      if (m != l) {
+        if (iter++ == kMaxQlIterations)
+          throw std::runtime_error("Eigenvalue iteration did not converge");
+        double g = (d[l + 1] - d[l]) / (2.0 * e[l]);
+        double r = hypot(g, 1.0);
+        g = d[m] - d[l] + e[l] / (g + (g >= 0.0 ? fabs(r) : -fabs(r)));
+        double s = 1.0, c = 1.0, p = 0.0;
+        int i;
+        for (i = m - 1; i >= l; i--) {
+          double f = s * e[i];
+          double b = c * e[i];
+          e[i + 1] = (r = hypot(f, g));
+          if (r == 0.0) {
+            d[i + 1] -= p;
+            e[m] = 0.0;
+            break;
+          }
+          s = f / r;
+          c = g / r;
+          g = d[i + 1] - p;
+          r = (d[i] - g) * s + 2.0 * c * b;
+          d[i + 1] = g + (p = s * r);
+          g = c * r - b;
+          if (zt) {
+            double *zi = zt + (size_t)i * n, *zi1 = zi + n;
+            for (int k = 0; k < n; k++) {
+              f = zi1[k];
+              zi1[k] = s * zi[k] + c * f;
+              zi[k] = c * zi[k] - s * f;
+            }
+          }
+        }
+        if (r == 0.0 && i >= l) continue;
+        d[l] -= p;
+        e[l] = g;
+        e[m] = 0.0;
+      }
+    } while (m != l);
+  }
+}
+
+// Односторонний метод Якоби: ортогонализует count строк w длины length.
+// Если vt != nullptr, вращения накапливаются в vt (count x count, начиная
+// с единичной). По завершении sigma[j] = |w_j|, строки w нормированы.
+void OneSidedJacobi(double *w, int count, int length, double *vt,
+                    double *sigma) {
+  std::vector<double> norms(count);
+  if (vt) {
+    std::fill(vt, vt + (size_t)count * count, 0.0);
+    for (int i = 0; i < count; i++) vt[(size_t)i * count + i] = 1.0;
+  }
+  // Порог как в LAPACK dgesvj: столбцы считаются ортогональными при
+  // |cos| <= sqrt(length) * eps
+  const double tolerance = sqrt((double)length) * kEpsilon;
+  bool rotated = true;
+  for (int sweep = 0; rotated && sweep < kMaxJacobiSweeps; sweep++) {
+    rotated = false;
+    for (int i = 0; i < count; i++) {
+      const double *wi = w + (size_t)i * length;
+      norms[i] = Dot(wi, wi, length);
+    }
+    for (int p = 0; p < count - 1; p++) {
+      for (int q = p + 1; q < count; q++) {
+        double alpha = norms[p], beta = norms[q];
+        if (alpha == 0.0 || beta == 0.0) continue;
+        double *wp = w + (size_t)p * length, *wq = w + (size_t)q * length;
+        double gamma = Dot(wp, wq, length);
+        if (fabs(gamma) <= tolerance * sqrt(alpha * beta)) continue;
+        rotated = true;
+        double zeta = (beta - alpha) / (2.0 * gamma);
+        double t = (zeta >= 0.0 ? 1.0 : -1.0) /
+                   (fabs(zeta) + sqrt(1.0 + zeta * zeta));
+        double c = 1.0 / sqrt(1.0 + t * t), s = c * t;
+        for (int k = 0; k < length; k++) {
+          double x = wp[k], y = wq[k];
+          wp[k] = c * x - s * y;
+          wq[k] = s * x + c * y;
+        }
+        norms[p] = alpha - t * gamma;
+        norms[q] = beta + t * gamma;
+        if (vt) {
+          double *vp = vt + (size_t)p * count, *vq = vt + (size_t)q * count;
+          for (int k = 0; k < count; k++) {
+            double x = vp[k], y = vq[k];
+            vp[k] = c * x - s * y;
+            vq[k] = s * x + c * y;
+          }
+        }
+      }
+    }
+  }
+  if (rotated)
+    throw std::runtime_error("Singular value iteration did not converge");
+  for (int i = 0; i < count; i++) {
+    double *wi = w + (size_t)i * length;
+    sigma[i] = sqrt(Dot(wi, wi, length));
+    if (sigma[i] != 0.0)
+      for (int k = 0; k < length; k++) wi[k] /= sigma[i];
+  }
+}
+
+// Модифицированный Грам-Шмидт по строкам (count x length), с повторной
+// ортогонализацией. Вырожденные строки заменяются ортами, чтобы базис
+// оставался полным.
+void OrthonormalizeRows(double *w, int count, int length) {
+  auto project = [w, length](double *wi, int i) {
+    for (int pass = 0; pass < 2; pass++) {
+      for (int j = 0; j < i; j++) {
+        const double *wj = w + (size_t)j * length;
+        double dot = Dot(wi, wj, length);
+        for (int k = 0; k < length; k++) wi[k] -= dot * wj[k];
+      }
+    }
+    return sqrt(Dot(wi, wi, length));
+  };
+  int next_unit = 0;
+  for (int i = 0; i < count; i++) {
+    double *wi = w + (size_t)i * length;
+    double original = sqrt(Dot(wi, wi, length));
+    double norm = project(wi, i);
+    while ((norm == 0.0 || norm <= 1e-10 * original) && next_unit < length) {
+      std::fill(wi, wi + length, 0.0);
+      wi[next_unit++] = 1.0;
+      original = 1.0;
+      norm = project(wi, i);
+    }
+    if (norm != 0.0)
+      for (int k = 0; k < length; k++) wi[k] /= norm;
+  }
+}
+
+// Обнуление блока m x n; большой блок обнуляется теми же потоками, что
+// потом пишут в него в ParallelGemm
+void ZeroRows(double *c, int m, int n) {
+  storage::Fill(m, n, [=](int begin, int end) {
+    std::fill(c + (size_t)begin * n, c + (size_t)end * n, 0.0);
+  });
+}
+
+// Копирование строк матрицы rows x cols, см. storage::Fill
+void CopyRows(double *const *target, double *const *source, int rows,
+              int cols) {
+  storage::Fill(rows, cols, [=](int begin, int end) {
+    for (int i = begin; i < end; i++)
+      memcpy(target[i], source[i], cols * sizeof(double));
+  });
+}
+
+// C (m x n) = A (m x k) * B (k x n), всё по строкам
+void MultiplyRows(const double *a, const double *b, double *c, int m, int n,
+                  int k) {
+  ZeroRows(c, m, n);
+  ParallelGemm(false, false, m, n, k, 1.0, a, k, b, n, c, n);
+}
+
+// C (m x n) = A (m x k) * B^T, где B хранится как n x k
+void MultiplyRowsTransposed(const double *a, const double *b, double *c,
+                            int m, int n, int k) {
+  ZeroRows(c, m, n);
+  ParallelGemm(false, true, m, n, k, 1.0, a, k, b, k, c, n);
+}
+
+// Матрица length x count, столбец j которой - строка order[j] из rows
+Matrix ColumnsFromRows(const double *rows, const std::vector<int> &order,
+                       int count, int length) {
+  return Matrix::FromGenerator(length, count, [&](int i, int j) {
+    return rows[(size_t)order[j] * length + i];
+  });
+}
+
+// Разложение панели - строк [k0, n) и столбцов [k0, k1) матрицы a (n x n
+// по строкам) - с частичным выбором ведущего элемента. На шаге k меняются
+// местами строки k и pivots[k], но только внутри панели. Возвращает false,
+// если встретился нулевой ведущий элемент или переполнился тип T.
+template <typename T>
+bool PanelFactor(T *a, int n, int k0, int k1, int *pivots) {
+  bool regular = true;
+  for (int k = k0; k < k1; k++) {
+    int pivot = k;
+    for (int i = k + 1; i < n; i++) {
+      if (fabs(a[(size_t)i * n + k]) > fabs(a[(size_t)pivot * n + k]))
+        pivot = i;
+    }
+    pivots[k] = pivot;
+    T *ak = a + (size_t)k * n;
+    if (pivot != k)
+      std::swap_ranges(ak + k0, ak + k1, a + (size_t)pivot * n + k0);
+    if (ak[k] == T(0) || !std::isfinite(ak[k])) {
+      regular = false;
+      continue;
+    }
+    for (int i = k + 1; i < n; i++) {
+      T *ai = a + (size_t)i * n;
+      T l = ai[k] /= ak[k];
+      for (int j = k + 1; j < k1; j++) ai[j] -= l * ak[j];
+    }
+  }
+  return regular;
+}
+
+// Обновление столбцов [j0, j1) после разложения панели [k0, k1):
+// перестановки строк, U12 = L11^-1 * A12 и A22 -= L21 * U12
+template <typename T>
+void UpdateBlock(T *a, int n, int k0, int k1, int j0, int j1,
+                 const int *pivots) {
+  for (int p = k0; p < k1; p++) {
+    if (pivots[p] != p) {
+      std::swap_ranges(a + (size_t)p * n + j0, a + (size_t)p * n + j1,
+                       a + (size_t)pivots[p] * n + j0);
+    }
+  }
+  for (int i = k0 + 1; i < k1; i++) {
+    T *ai = a + (size_t)i * n;
+    for (int c = k0; c < i; c++) {
+      T l = ai[c];
+      const T *ac = a + (size_t)c * n;
+      for (int j = j0; j < j1; j++) ai[j] -= l * ac[j];
+    }
+  }
+  if (k1 < n) {
+    Gemm(false, false, n - k1, j1 - j0, k1 - k0, T(-1),
+         a + (size_t)k1 * n + k0, n, a + (size_t)k0 * n + j0, n,
+         a + (size_t)k1 * n + j0, n);
+  }
+}
+
+// Блочное LU-разложение на месте (a - n x n по строкам), на шаге k
+// меняются местами строки k и pivots[k]. Столбцы разбиты на блоки по
+// kLuBlock; задачи "панель k" и "обновление блока j после панели k"
+// образуют граф, в котором панель k + 1 зависит только от обновления
+// блока k + 1, поэтому она считается параллельно с остальными
+// обновлениями шага k (lookahead). Возвращает false, если матрица
+// вырождена (или переполнился тип T).
+template <typename T>
+bool LuFactor(T *a, int n, int *pivots) {
+  if (n <= kLuBlock) return PanelFactor(a, n, 0, n, pivots);
+  int blocks = (n + kLuBlock - 1) / kLuBlock;
+  std::atomic<bool> regular(true);
+  TaskGraph graph;
+  graph.setCancellable(true);
+  std::vector<int> last_update(blocks, -1);
+  for (int k = 0; k < blocks; k++) {
+    int k0 = k * kLuBlock, k1 = std::min(n, k0 + kLuBlock);
+    int panel = graph.Add(
+        [=, &regular] {
+          if (!PanelFactor(a, n, k0, k1, pivots)) regular = false;
+        },
+        2);
+    if (last_update[k] >= 0) graph.Depend(panel, last_update[k]);
+    for (int j = k + 1; j < blocks; j++) {
+      int j0 = j * kLuBlock, j1 = std::min(n, j0 + kLuBlock);
+      int update =
+          graph.Add([=] { UpdateBlock(a, n, k0, k1, j0, j1, pivots); },
+                    j == k + 1 ? 1 : 0);
+      graph.Depend(update, panel);
+      if (last_update[j] >= 0) graph.Depend(update, last_update[j]);
+      last_update[j] = update;
+    }
+  }
+  graph.Run(Executor::Instance());
+  for (int p = kLuBlock; p < n; p++) {
+    if (pivots[p] != p) {
+      int k0 = p / kLuBlock * kLuBlock;
+      std::swap_ranges(a + (size_t)p * n, a + (size_t)p * n + k0,
+                       a + (size_t)pivots[p] * n);
+    }
+  }
+  return regular;
+}
+
+template <typename T>
+T LuDeterminant(const T *lu, int n, const int *pivots) {
+  T result = 1;
+  for (int i = 0; i < n; i++) {
+    result *= lu[(size_t)i * n + i];
+    if (pivots[i] != i) result = -result;
+  }
+  return result;
+}
+
+// Решение L U X = P B на месте, b - n x nrhs по строкам. Столбцы правой
+// части независимы и делятся между потоками.
+template <typename T>
+void LuSolve(const T *lu, int n, const int *pivots, T *b, int nrhs) {
+  auto solve = [=](int begin, int end) {
+    for (int k = 0; k < n; k++) {
+      if (pivots[k] != k) {
+        std::swap_ranges(b + (size_t)k * nrhs + begin,
+                         b + (size_t)k * nrhs + end,
+                         b + (size_t)pivots[k] * nrhs + begin);
+      }
+    }
+    for (int i = 1; i < n; i++) {
+      T *bi = b + (size_t)i * nrhs;
+      for (int k = 0; k < i; k++) {
+        T l = lu[(size_t)i * n + k];
+        const T *bk = b + (size_t)k * nrhs;
+        for (int j = begin; j < end; j++) bi[j] -= l * bk[j];
+      }
+    }
+    for (int i = n - 1; i >= 0; i--) {
+      T *bi = b + (size_t)i * nrhs;
+      for (int k = i + 1; k < n; k++) {
+        T u = lu[(size_t)i * n + k];
+        const T *bk = b + (size_t)k * nrhs;
+        for (int j = begin; j < end; j++) bi[j] -= u * bk[j];
+      }
+      for (int j = begin; j < end; j++) bi[j] /= lu[(size_t)i * n + i];
+    }
+  };
+  Executor &executor = Executor::Instance();
+  int grain = std::max(16, nrhs / (2 * executor.getThreadCount()));
+  executor.ParallelFor(0, nrhs, grain, solve);
+}
+
+// Итерационное уточнение решения A X = B по LU-разложению во float.
+// Критерий остановки как в LAPACK dsgesv: для каждого столбца
+// |r| <= sqrt(n) * eps * |A| * |x| (норма бесконечность). Возвращает false,
+// если невязка перестала убывать - тогда нужна факторизация в double.
+bool RefineSolution(const std::vector<double> &a, const std::vector<float> &lu,
+                    const std::vector<int> &pivots, int n,
+                    std::vector<double> &b, int nrhs, int *iterations) {
+  double a_norm = 0;
+  for (int i = 0; i < n; i++) {
+    double row = 0;
+    for (int j = 0; j < n; j++) row += fabs(a[(size_t)i * n + j]);
+    a_norm = std::max(a_norm, row);
+  }
+  const double bound = sqrt((double)n) * kEpsilon * a_norm;
+  std::vector<float> correction(b.begin(), b.end());
+  LuSolve(lu.data(), n, pivots.data(), correction.data(), nrhs);
+  std::vector<double> x(correction.begin(), correction.end()), r(b.size());
+  std::vector<double> r_norms(nrhs), x_norms(nrhs);
+  double previous = std::numeric_limits<double>::infinity();
+  for (int iteration = 0;; iteration++) {
+    *iterations = iteration;
+    r = b;
+    ParallelGemm(false, false, n, nrhs, n, -1.0, a.data(), n, x.data(), nrhs,
+                 r.data(), nrhs);
+    std::fill(r_norms.begin(), r_norms.end(), 0.0);
+    std::fill(x_norms.begin(), x_norms.end(), 0.0);
+    for (size_t i = 0; i < r.size(); i++) {
+      r_norms[i % nrhs] = std::max(r_norms[i % nrhs], fabs(r[i]));
+      x_norms[i % nrhs] = std::max(x_norms[i % nrhs], fabs(x[i]));
+    }
+    bool converged = true;
+    double residual = 0;
+    for (int j = 0; j < nrhs; j++) {
+      if (!std::isfinite(x_norms[j]) || !std::isfinite(r_norms[j]))
+        return false;
+      converged = converged && r_norms[j] <= bound * x_norms[j];
+      residual = std::max(residual, r_norms[j]);
+    }
+    if (converged) {
+      b = std::move(x);
+      return true;
+    }
+    if (iteration == kMaxRefinementIterations || residual > 0.5 * previous)
+      return false;
+    previous = residual;
+    std::copy(r.begin(), r.end(), correction.begin());
+    LuSolve(lu.data(), n, pivots.data(), correction.data(), nrhs);
+    for (size_t i = 0; i < x.size(); i++) x[i] += correction[i];
+  }
+}
+
+// Решение A X = B на месте b (a - n x n, b - n x nrhs, по строкам).
+// Система с |det A| < min_determinant считается вырожденной, как в
+// InverseMatrix(). Определитель по LU во float проверяется с запасом: если
+// он близок к порогу, решает факторизация в double.
+void SolveDense(const std::vector<double> &a, int n, std::vector<double> &b,
+                int nrhs, Precision precision, RefinementInfo *info,
+                double min_determinant = 0) {
+  RefinementInfo stats;
+  std::vector<int> pivots(n);
+  if (precision == Precision::kMixed) {
+    std::vector<float> lu(a.begin(), a.end());
+    if (LuFactor(lu.data(), n, pivots.data()) &&
+        fabs((double)LuDeterminant(lu.data(), n, pivots.data())) >=
+            2 * min_determinant &&
+        RefineSolution(a, lu, pivots, n, b, nrhs, &stats.iterations)) {
+      if (info) *info = stats;
+      return;
+    }
+    stats.fell_back = true;
+  }
+  std::vector<double> lu(a);
+  if (!LuFactor(lu.data(), n, pivots.data()) ||
+      fabs(LuDeterminant(lu.data(), n, pivots.data())) < min_determinant)
+    throw std::logic_error("Determinant can't be zero");
+  LuSolve(lu.data(), n, pivots.data(), b.data(), nrhs);
+  if (info) *info = stats;
+}
+
+// y += alpha * x
+void Accumulate(std::vector<double> &y, double alpha,
+                const std::vector<double> &x) {
+  for (size_t i = 0; i < y.size(); i++) y[i] += alpha * x[i];
+}
+
+std::vector<int> DescendingOrder(const std::vector<double> &values) {
+  std::vector<int> order(values.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&values](int a, int b) { return values[a] > values[b]; });
+  return order;
+}
+
+}  // namespace
 
 Matrix::Matrix() : matrix_(nullptr), rows_(0), cols_(0) {}
 
@@ -17,34 +551,100 @@ Matrix::Matrix(int rows, int cols) : rows_(rows), cols_(cols) {
   }
 }
 
+Matrix::Matrix(int rows, int cols, Uninitialized)
+    : rows_(rows), cols_(cols) {
+  if (rows < 1 || cols < 1)
+    throw std::length_error(
+        "Invalid input, matrices must have a positive size");
+  AllocateMatrix(false);
+}
+
 Matrix::Matrix(const Matrix &other)
     : rows_(other.rows_), cols_(other.cols_) {
   try {
-    this->AllocateMatrix();
+    this->AllocateMatrix(false);
   } catch (std::bad_alloc &e) {
     throw e;
   }
-  for (int i = 0; i < rows_; ++i) {
-    memcpy(matrix_[i], other.matrix_[i], cols_ * sizeof(double));
-  }
+  CopyRows(matrix_, other.matrix_, rows_, cols_);
 }
 
 Matrix::Matrix(Matrix &&other) noexcept
-    : matrix_(other.matrix_), rows_(other.rows_), cols_(other.cols_) {
+    : matrix_(other.matrix_),
+      rows_(other.rows_),
+      cols_(other.cols_),
+      adopted_(other.adopted_),
+      fingerprint_state_(other.fingerprint_state_.load()),
+      fingerprint_(other.fingerprint_) {
   other.rows_ = 0;
   other.cols_ = 0;
   other.matrix_ = nullptr;
+  other.adopted_ = false;
+  other.fingerprint_state_.store(kFingerprintEmpty, std::memory_order_relaxed);
 }
 
 Matrix::~Matrix() noexcept {
-  for (int i = 0; i < rows_; ++i) {
-    delete[] matrix_[i];
-    matrix_[i] = nullptr;
+  if (matrix_ && adopted_) {
+    delete[] matrix_[0];
+  } else if (matrix_) {
+    storage::Free(matrix_[0], rows_, cols_);
   }
   delete[] matrix_;
   matrix_ = nullptr;
+  adopted_ = false;
+}
+
+Matrix Matrix::Identity(int size) {
+  Matrix result(size, size);
+  for (int i = 0; i < size; i++) result.matrix_[i][i] = 1;
+  return result;
 }
 
+Matrix Matrix::Filled(int rows, int cols, double value) {
+  Matrix result(rows, cols, uninitialized);
+  double *values = result.matrix_[0];
+  storage::Fill(rows, cols, [=](int begin, int end) {
+    std::fill(values + (size_t)begin * cols, values + (size_t)end * cols,
+              value);
+  });
+  return result;
+}
+
+Matrix Matrix::FromBuffer(int rows, int cols, const double *data) {
+  if (!data) throw std::invalid_argument("The buffer is empty");
+  Matrix result(rows, cols, uninitialized);
+  double *values = result.matrix_[0];
+  storage::Fill(rows, cols, [=](int begin, int end) {
+    memcpy(values + (size_t)begin * cols, data + (size_t)begin * cols,
+           (size_t)(end - begin) * cols * sizeof(double));
+  });
+  return result;
+}
+
+Matrix Matrix::FromBuffer(int rows, int cols, std::unique_ptr<double[]> data) {
+  if (!data) throw std::invalid_argument("The buffer is empty");
+  if (rows < 1 || cols < 1)
+    throw std::length_error(
+        "Invalid input, matrices must have a positive size");
+  Matrix result;
+  result.matrix_ = new double *[rows];
+  result.rows_ = rows;
+  result.cols_ = cols;
+  result.matrix_[0] = data.release();
+  result.adopted_ = true;
+  for (int i = 1; i < rows; ++i)
+    result.matrix_[i] = result.matrix_[i - 1] + cols;
+  return result;
+}
+
+void Matrix::setPlacementPolicy(const PlacementPolicy &policy) {
+  storage::setPolicy(policy);
+}
+
+PlacementPolicy Matrix::getPlacementPolicy() { return storage::getPolicy(); }
+
+int Matrix::getNumaNodes() noexcept { return storage::getNodeCount(); }
+
 int Matrix::getRows() const noexcept { return rows_; }
 
 int Matrix::getCols() const noexcept { return cols_; }
@@ -54,11 +654,18 @@ void Matrix::setRows(const int rows) {
     throw std::length_error(
         "Invalid input, matrices must have a positive size");
   if (rows != rows_) {
-    Matrix tmp(rows, cols_);
+    // Обнуляются только новые строки
+    Matrix tmp(rows, cols_, uninitialized);
     int filling_rows = rows_ < rows ? rows_ : rows;
-    for (int i = 0; i < filling_rows; i++) {
-      memcpy(tmp.matrix_[i], matrix_[i], cols_ * sizeof(double));
-    }
+    storage::Fill(rows, cols_, [&](int begin, int end) {
+      for (int i = begin; i < end; i++) {
+        if (i < filling_rows) {
+          memcpy(tmp.matrix_[i], matrix_[i], cols_ * sizeof(double));
+        } else {
+          std::fill(tmp.matrix_[i], tmp.matrix_[i] + cols_, 0.0);
+        }
+      }
+    });
     *this = std::move(tmp);
   }
 }
@@ -68,11 +675,14 @@ void Matrix::setCols(const int cols) {
     throw std::length_error(
         "Invalid input, matrices must have a positive size");
   if (cols != cols_) {
-    Matrix tmp(rows_, cols);
+    Matrix tmp(rows_, cols, uninitialized);
     int filling_cols = cols_ < cols ? cols_ : cols;
-    for (int i = 0; i < rows_; i++) {
-      memcpy(tmp.matrix_[i], matrix_[i], filling_cols * sizeof(double));
-    }
+    storage::Fill(rows_, cols, [&](int begin, int end) {
+      for (int i = begin; i < end; i++) {
+        memcpy(tmp.matrix_[i], matrix_[i], filling_cols * sizeof(double));
+        std::fill(tmp.matrix_[i] + filling_cols, tmp.matrix_[i] + cols, 0.0);
+      }
+    });
     *this = std::move(tmp);
   }
 }
@@ -80,16 +690,35 @@ void Matrix::setCols(const int cols) {
 bool Matrix::EqMatrix(const Matrix &other) const noexcept {
   if (cols_ != other.cols_ || rows_ != other.rows_) {
     return false;
-  } else {
+  } else if (this != &other && rows_ > 0) {
+    // Каждая сумма в отпечатке - сумма элементов с весами +-1, поэтому у
+    // равных матриц суммы отличаются не больше чем на count * 1e-7 плюс
+    // погрешность округления при суммировании
+    if (fingerprint_state_.load(std::memory_order_acquire) ==
+            kFingerprintReady &&
+        other.fingerprint_state_.load(std::memory_order_acquire) ==
+            kFingerprintReady) {
+      const Fingerprint &a = fingerprint_, &b = other.fingerprint_;
+      double count = (double)rows_ * cols_;
+      double slack = count * kEqualityTolerance +
+                     4 * count * kEpsilon * (a.abs_sum + b.abs_sum);
+      if (fabs(a.sum - b.sum) > slack ||
+          fabs(a.alternating_sum - b.alternating_sum) > slack ||
+          fabs(a.abs_sum - b.abs_sum) > slack)
+        return false;
+    }
     for (int i = 0; i < rows_; i++) {
       for (int j = 0; j < cols_; j++) {
-        if (fabs(matrix_[i][j] - other.matrix_[i][j]) > 1e-7) return false;
+        if (fabs(matrix_[i][j] - other.matrix_[i][j]) > kEqualityTolerance)
+          return false;
       }
     }
   }
   return true;
 }
 
+size_t Matrix::getHash() const noexcept { return getFingerprint().hash; }
+
 void Matrix::SumMatrix(const Matrix &other) {
   if (cols_ != other.cols_ || rows_ != other.rows_)
     throw std::out_of_range("Matrix must be the same size");
@@ -98,6 +727,7 @@ void Matrix::SumMatrix(const Matrix &other) {
       matrix_[i][j] += other.matrix_[i][j];
     }
   }
+  Invalidate();
 }
 
 void Matrix::SubMatrix(const Matrix &other) {
@@ -108,6 +738,7 @@ void Matrix::SubMatrix(const Matrix &other) {
       matrix_[i][j] -= other.matrix_[i][j];
     }
   }
+  Invalidate();
 }
 
 void Matrix::MulNumber(const double num) noexcept {
@@ -116,53 +747,53 @@ void Matrix::MulNumber(const double num) noexcept {
       matrix_[i][j] *= num;
     }
   }
+  Invalidate();
 }
 
 void Matrix::MulMatrix(const Matrix &other) {
+  *this = Multiply(other, false);
+}
+
+Matrix Matrix::Multiply(const Matrix &other, bool cancellable) const {
   if (cols_ != other.rows_)
     throw std::out_of_range(
         "The number of columns of the first matrix is not equal to the "
         "number of rows of the second matrix");
-  Matrix tmp(rows_, cols_);
-  for (int i = 0; i < rows_; i++) {
-    for (int j = 0; j < other.cols_; j++) {
-      for (int k = 0; k < rows_; k++) {
-        tmp.matrix_[i][j] += matrix_[i][k] * other.matrix_[k][j];
-      }
-    }
-  }
-  *this = std::move(tmp);
+  // Gemm прибавляет к результату, поэтому он должен быть обнулён
+  Matrix result(rows_, other.cols_);
+  ParallelGemm(false, false, rows_, other.cols_, cols_, 1.0, matrix_[0],
+               cols_, other.matrix_[0], other.cols_, result.matrix_[0],
+               other.cols_, cancellable);
+  return result;
 }
 
 Matrix Matrix::Transpose() const noexcept {
-  Matrix result(rows_, cols_);
-  for (int i = 0; i < rows_; i++) {
-    for (int j = 0; j < cols_; j++) {
-      result.matrix_[j][i] = matrix_[i][j];
+  Matrix result(cols_, rows_, uninitialized);
+  // Каждый поток пишет свой отрезок строк результата
+  storage::Fill(cols_, rows_, [&](int begin, int end) {
+    for (int i = 0; i < rows_; i++) {
+      for (int j = begin; j < end; j++) {
+        result.matrix_[j][i] = matrix_[i][j];
+      }
     }
-  }
+  });
   return result;
 }
 
 double Matrix::Determinant() const {
   if (cols_ != rows_) throw std::logic_error("The matrix is not square");
-  if (rows_ == 1) {
+  // У пустой матрицы нет хранилища; как и раньше, её определитель 0
+  if (rows_ == 0) {
+    return 0;
+  } else if (rows_ == 1) {
     return matrix_[0][0];
   } else if (rows_ == 2) {
     return matrix_[0][0] * matrix_[1][1] - matrix_[0][1] * matrix_[1][0];
   } else {
-    double determinant = 0;
-    double result = 0;
-    for (int i = 0; i < rows_; i++) {
-      Matrix minor = this->Minor(1, i + 1);
-      determinant = minor.Determinant();
-      if (i % 2 == 0) {
-        result += matrix_[0][i] * determinant;
-      } else {
-        result -= matrix_[0][i] * determinant;
-      }
-    }
-    return result;
+    std::vector<double> lu(matrix_[0], matrix_[0] + (size_t)rows_ * cols_);
+    std::vector<int> pivots(rows_);
+    LuFactor(lu.data(), rows_, pivots.data());
+    return LuDeterminant(lu.data(), rows_, pivots.data());
   }
 }
 
@@ -173,7 +804,7 @@ Matrix Matrix::CalcComplements() const {
   } catch (std::logic_error &e) {
     throw e;
   }
-  Matrix result(rows_, cols_);
+  Matrix result(rows_, cols_, uninitialized);
   if (cols_ == 1) {
     determinant = this->Determinant();
     result.matrix_[0][0] = determinant;
@@ -194,21 +825,325 @@ Matrix Matrix::CalcComplements() const {
 }
 
 Matrix Matrix::InverseMatrix() const {
-  double determinant;
-  try {
-    determinant = this->Determinant();
-  } catch (std::logic_error &e) {
-    throw e;
-  }
-  if (fabs(determinant) < 1e-06)
+  if (cols_ != rows_) throw std::logic_error("The matrix is not square");
+  if (rows_ == 0) throw std::logic_error("Determinant can't be zero");
+  std::vector<double> lu(matrix_[0], matrix_[0] + (size_t)rows_ * cols_);
+  std::vector<int> pivots(rows_);
+  LuFactor(lu.data(), rows_, pivots.data());
+  if (fabs(LuDeterminant(lu.data(), rows_, pivots.data())) < 1e-06)
     throw std::logic_error("Determinant can't be zero");
-  Matrix transpose_calc_complements = this->CalcComplements().Transpose();
-  transpose_calc_complements.MulNumber(1 / determinant);
-  return transpose_calc_complements;
+  Matrix result = Identity(rows_);
+  LuSolve(lu.data(), rows_, pivots.data(), result.matrix_[0], cols_);
+  return result;
+}
+
+Matrix Matrix::InverseMatrix(Precision precision, RefinementInfo *info) const {
+  if (cols_ != rows_) throw std::logic_error("The matrix is not square");
+  if (rows_ == 0) throw std::logic_error("Determinant can't be zero");
+  int n = rows_;
+  std::vector<double> a(matrix_[0], matrix_[0] + (size_t)n * n);
+  std::vector<double> b((size_t)n * n, 0.0);
+  for (int i = 0; i < n; i++) b[(size_t)i * n + i] = 1;
+  SolveDense(a, n, b, n, precision, info, 1e-06);
+  Matrix result(n, n, uninitialized);
+  storage::Fill(n, n, [&](int begin, int end) {
+    memcpy(result.matrix_[begin], &b[(size_t)begin * n],
+           (size_t)(end - begin) * n * sizeof(double));
+  });
+  return result;
+}
+
+Matrix Matrix::Solve(const Matrix &other, Precision precision,
+                     RefinementInfo *info) const {
+  if (cols_ != rows_) throw std::logic_error("The matrix is not square");
+  if (other.rows_ != rows_)
+    throw std::out_of_range(
+        "The number of rows of the right-hand side is not equal to the size "
+        "of the matrix");
+  int n = rows_, nrhs = other.cols_;
+  std::vector<double> a((size_t)n * n), b((size_t)n * nrhs);
+  for (int i = 0; i < n; i++) {
+    memcpy(&a[(size_t)i * n], matrix_[i], n * sizeof(double));
+    memcpy(&b[(size_t)i * nrhs], other.matrix_[i], nrhs * sizeof(double));
+  }
+  SolveDense(a, n, b, nrhs, precision, info);
+  Matrix result(n, nrhs, uninitialized);
+  storage::Fill(n, nrhs, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      memcpy(result.matrix_[i], &b[(size_t)i * nrhs], nrhs * sizeof(double));
+    }
+  });
+  return result;
+}
+
+Matrix Matrix::Pow(int power) const {
+  if (cols_ != rows_) throw std::logic_error("The matrix is not square");
+  int n = rows_;
+  if (power == 0) return Identity(n);
+  // Три буфера на всё возведение: результат, текущий квадрат основания и
+  // рабочий, который после каждого умножения меняется местами с приёмником
+  Matrix base = power > 0 ? *this : InverseMatrix();
+  Matrix result(n, n, uninitialized), scratch(n, n, uninitialized);
+  unsigned exponent = power > 0 ? (unsigned)power : 0u - (unsigned)power;
+  bool started = false;
+  while (true) {
+    if (exponent & 1u) {
+      if (started) {
+        MultiplyRows(result.matrix_[0], base.matrix_[0], scratch.matrix_[0],
+                     n, n, n);
+        std::swap(result, scratch);
+      } else {
+        CopyRows(result.matrix_, base.matrix_, n, n);
+        started = true;
+      }
+    }
+    exponent >>= 1;
+    if (!exponent) break;
+    MultiplyRows(base.matrix_[0], base.matrix_[0], scratch.matrix_[0], n, n,
+                 n);
+    std::swap(base, scratch);
+  }
+  return result;
+}
+
+Matrix Matrix::Exp() const {
+  if (cols_ != rows_) throw std::logic_error("The matrix is not square");
+  if (rows_ == 0)
+    throw std::length_error(
+        "Invalid input, matrices must have a positive size");
+  int n = rows_;
+  size_t size = (size_t)n * n;
+  double norm = 0;
+  for (int j = 0; j < n; j++) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) sum += fabs(matrix_[i][j]);
+    norm = std::max(norm, sum);
+  }
+  // Наименьший достаточный порядок; если не хватает и 13-го, матрица
+  // делится на 2^squarings, а результат потом столько же раз возводится
+  // в квадрат
+  int degree = 0, squarings = 0;
+  while (degree < 4 && norm > kPadeThetas[degree]) degree++;
+  if (norm > kPadeThetas[4])
+    squarings = (int)ceil(log2(norm / kPadeThetas[4]));
+  const double *b = kPadeCoefficients[degree];
+  std::vector<double> a(matrix_[0], matrix_[0] + size);
+  double scale = ldexp(1.0, -squarings);
+  for (double &x : a) x *= scale;
+
+  // exp(A) ~ (V - U)^-1 (V + U), U - нечётная часть многочлена Паде,
+  // V - чётная; обе собираются из чётных степеней A
+  std::vector<double> u(size), v(size), odd(size);
+  std::vector<std::vector<double>> even(1, std::vector<double>(size));
+  int order = kPadeOrders[degree];
+  int powers = order == 13 ? 3 : (order - 1) / 2;
+  for (int p = 1; p <= powers; p++) {
+    even.emplace_back(size);
+    const std::vector<double> &left = p == 1 ? a : even[p - 1];
+    const std::vector<double> &right = p == 1 ? a : even[1];
+    MultiplyRows(left.data(), right.data(), even[p].data(), n, n, n);
+  }
+  if (order == 13) {
+    // A^6 (b13 A^6 + b11 A^4 + b9 A^2) + ...: всего 6 умножений
+    std::vector<double> high(size);
+    Accumulate(high, b[13], even[3]);
+    Accumulate(high, b[11], even[2]);
+    Accumulate(high, b[9], even[1]);
+    MultiplyRows(even[3].data(), high.data(), odd.data(), n, n, n);
+    std::fill(high.begin(), high.end(), 0.0);
+    Accumulate(high, b[12], even[3]);
+    Accumulate(high, b[10], even[2]);
+    Accumulate(high, b[8], even[1]);
+    MultiplyRows(even[3].data(), high.data(), v.data(), n, n, n);
+    for (int p = 1; p <= 3; p++) {
+      Accumulate(odd, b[2 * p + 1], even[p]);
+      Accumulate(v, b[2 * p], even[p]);
+    }
+  } else {
+    for (int p = 1; p <= powers; p++) {
+      Accumulate(odd, b[2 * p + 1], even[p]);
+      Accumulate(v, b[2 * p], even[p]);
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    odd[(size_t)i * n + i] += b[1];
+    v[(size_t)i * n + i] += b[0];
+  }
+  MultiplyRows(a.data(), odd.data(), u.data(), n, n, n);
+  std::vector<double> denominator(v), numerator(v);
+  Accumulate(denominator, -1.0, u);
+  Accumulate(numerator, 1.0, u);
+  SolveDense(denominator, n, numerator, n, Precision::kDouble, nullptr);
+
+  Matrix result(n, n, uninitialized), scratch(n, n, uninitialized);
+  storage::Fill(n, n, [&](int begin, int end) {
+    memcpy(result.matrix_[begin], &numerator[(size_t)begin * n],
+           (size_t)(end - begin) * n * sizeof(double));
+  });
+  for (int i = 0; i < squarings; i++) {
+    MultiplyRows(result.matrix_[0], result.matrix_[0], scratch.matrix_[0], n,
+                 n, n);
+    std::swap(result, scratch);
+  }
+  return result;
+}
+
+std::future<Matrix> Matrix::MulAsync(Matrix other, int priority,
+                                     CancellationToken token) const {
+  return Executor::Instance().Async(
+      [self = *this, other = std::move(other)] {
+        return self.Multiply(other, true);
+      },
+      priority, std::move(token));
+}
+
+std::future<Matrix> Matrix::InverseAsync(int priority,
+                                         CancellationToken token) const {
+  return Executor::Instance().Async(
+      [self = *this] { return self.InverseMatrix(); }, priority,
+      std::move(token));
+}
+
+std::future<Matrix> Matrix::SolveAsync(Matrix other, Precision precision,
+                                       int priority,
+                                       CancellationToken token) const {
+  return Executor::Instance().Async(
+      [self = *this, other = std::move(other), precision] {
+        return self.Solve(other, precision);
+      },
+      priority, std::move(token));
+}
+
+std::future<double> Matrix::DeterminantAsync(int priority,
+                                             CancellationToken token) const {
+  return Executor::Instance().Async(
+      [self = *this] { return self.Determinant(); }, priority,
+      std::move(token));
+}
+
+EigenDecomposition Matrix::EigenSymmetric(bool compute_vectors) const {
+  if (cols_ != rows_) throw std::logic_error("The matrix is not square");
+  if (rows_ == 0)
+    throw std::length_error(
+        "Invalid input, matrices must have a positive size");
+  int n = rows_;
+  std::vector<double> z((size_t)n * n);
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < i; j++) {
+      if (fabs(matrix_[i][j] - matrix_[j][i]) > 1e-7)
+        throw std::logic_error("The matrix is not symmetric");
+    }
+    memcpy(&z[(size_t)i * n], matrix_[i], n * sizeof(double));
+  }
+  std::vector<double> d(n), e(n), zt;
+  Tridiagonalize(z.data(), n, d.data(), e.data(), compute_vectors);
+  if (compute_vectors) {
+    zt.resize(z.size());
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < n; j++) zt[(size_t)j * n + i] = z[(size_t)i * n + j];
+    }
+  }
+  TridiagonalQl(d.data(), e.data(), n, compute_vectors ? zt.data() : nullptr);
+  std::vector<int> order = DescendingOrder(d);
+  std::reverse(order.begin(), order.end());
+  EigenDecomposition result{Matrix(n, 1, uninitialized), Matrix()};
+  for (int i = 0; i < n; i++) result.values.matrix_[i][0] = d[order[i]];
+  if (compute_vectors) result.vectors = ColumnsFromRows(zt.data(), order, n, n);
+  return result;
+}
+
+SingularValueDecomposition Matrix::SVD(bool compute_vectors) const {
+  // Столбцы A (или строки, если матрица широкая) ортогонализуются методом
+  // Якоби; храним их строками, чтобы вращения шли по непрерывной памяти
+  bool tall = rows_ >= cols_;
+  int count = tall ? cols_ : rows_, length = tall ? rows_ : cols_;
+  std::vector<double> w((size_t)count * length);
+  for (int i = 0; i < rows_; i++) {
+    if (tall) {
+      for (int j = 0; j < cols_; j++) w[(size_t)j * length + i] = matrix_[i][j];
+    } else {
+      memcpy(&w[(size_t)i * length], matrix_[i], cols_ * sizeof(double));
+    }
+  }
+  std::vector<double> vt, sigma(count);
+  if (compute_vectors) vt.resize((size_t)count * count);
+  OneSidedJacobi(w.data(), count, length, compute_vectors ? vt.data() : nullptr,
+                 sigma.data());
+  std::vector<int> order = DescendingOrder(sigma);
+  SingularValueDecomposition result{Matrix(), Matrix(count, 1, uninitialized),
+                                    Matrix()};
+  for (int i = 0; i < count; i++) result.s.matrix_[i][0] = sigma[order[i]];
+  if (compute_vectors) {
+    std::vector<double> sorted(w.size());
+    for (int i = 0; i < count; i++) {
+      memcpy(&sorted[(size_t)i * length], &w[(size_t)order[i] * length],
+             length * sizeof(double));
+    }
+    OrthonormalizeRows(sorted.data(), count, length);
+    std::vector<int> identity(count);
+    std::iota(identity.begin(), identity.end(), 0);
+    Matrix columns = ColumnsFromRows(sorted.data(), identity, count, length);
+    Matrix rotations = ColumnsFromRows(vt.data(), order, count, count);
+    result.u = tall ? std::move(columns) : std::move(rotations);
+    result.v = tall ? std::move(rotations) : std::move(columns);
+  }
+  return result;
+}
+
+SingularValueDecomposition Matrix::TruncatedSVD(int rank, int oversampling,
+                                                int power_iterations) const {
+  int m = rows_, n = cols_;
+  if (rank < 1 || rank > std::min(m, n) || oversampling < 0 ||
+      power_iterations < 0)
+    throw std::out_of_range("Invalid parameters of truncated SVD");
+  // Рандомизированный SVD: Q - ортонормированный базис образа A * Omega,
+  // уточнённый степенными итерациями, затем точный SVD малой B = Q^T * A.
+  // Все промежуточные матрицы хранятся транспонированными (l строк)
+  int l = std::min(rank + oversampling, std::min(m, n));
+  std::vector<double> a((size_t)m * n);
+  for (int i = 0; i < m; i++) {
+    memcpy(&a[(size_t)i * n], matrix_[i], n * sizeof(double));
+  }
+  std::mt19937_64 generator(20240917);
+  std::normal_distribution<double> normal;
+  std::vector<double> qt((size_t)l * m), zt((size_t)l * n);
+  for (double &x : zt) x = normal(generator);
+  MultiplyRowsTransposed(zt.data(), a.data(), qt.data(), l, m, n);
+  OrthonormalizeRows(qt.data(), l, m);
+  for (int iteration = 0; iteration < power_iterations; iteration++) {
+    MultiplyRows(qt.data(), a.data(), zt.data(), l, n, m);
+    OrthonormalizeRows(zt.data(), l, n);
+    MultiplyRowsTransposed(zt.data(), a.data(), qt.data(), l, m, n);
+    OrthonormalizeRows(qt.data(), l, m);
+  }
+  MultiplyRows(qt.data(), a.data(), zt.data(), l, n, m);
+  std::vector<double> vt((size_t)l * l), sigma(l);
+  OneSidedJacobi(zt.data(), l, n, vt.data(), sigma.data());
+  std::vector<int> order = DescendingOrder(sigma);
+  order.resize(rank);
+  SingularValueDecomposition result{Matrix(), Matrix(rank, 1, uninitialized),
+                                    Matrix()};
+  std::vector<double> ut((size_t)rank * m, 0.0), right((size_t)rank * n);
+  for (int j = 0; j < rank; j++) {
+    result.s.matrix_[j][0] = sigma[order[j]];
+    double *uj = &ut[(size_t)j * m];
+    for (int r = 0; r < l; r++) {
+      double coefficient = vt[(size_t)order[j] * l + r];
+      const double *qr = &qt[(size_t)r * m];
+      for (int i = 0; i < m; i++) uj[i] += coefficient * qr[i];
+    }
+    memcpy(&right[(size_t)j * n], &zt[(size_t)order[j] * n],
+           n * sizeof(double));
+  }
+  OrthonormalizeRows(right.data(), rank, n);
+  std::iota(order.begin(), order.end(), 0);
+  result.u = ColumnsFromRows(ut.data(), order, rank, m);
+  result.v = ColumnsFromRows(right.data(), order, rank, n);
+  return result;
 }
 
 Matrix Matrix::Minor(int row, int column) const noexcept {
-  Matrix result(rows_ - 1, cols_ - 1);
+  Matrix result(rows_ - 1, cols_ - 1, uninitialized);
   for (int i = 0, o = 0; i < rows_; i++) {
     if (i == row - 1) {
       continue;
@@ -225,28 +1160,73 @@ Matrix Matrix::Minor(int row, int column) const noexcept {
   return result;
 }
 
-void Matrix::AllocateMatrix() {
+void Matrix::AllocateMatrix(bool zero) {
+  if (rows_ < 1 || cols_ < 1) {
+    matrix_ = nullptr;
+    return;
+  }
   matrix_ = new double *[rows_];
-  if (!matrix_) {
+  // Все строки лежат в одном непрерывном блоке, чтобы ядра (Gemm, LU)
+  // работали прямо с хранилищем матрицы
+  try {
+    matrix_[0] = storage::Allocate(rows_, cols_, zero);
+  } catch (...) {
+    delete[] matrix_;
+    matrix_ = nullptr;
     rows_ = 0;
     cols_ = 0;
-    throw std::bad_alloc();
+    throw;
   }
-  for (int i = 0; i < rows_; ++i) {
-    matrix_[i] = new double[cols_]{0};
-    // Выделение памяти под указатели на строки
-    if (!matrix_[i]) {
-      // Освобождение памяти, если не удалось выделить
-      cols_ = i;
-      this->~Matrix();
-      throw std::bad_alloc();
+  for (int i = 1; i < rows_; ++i) matrix_[i] = matrix_[i - 1] + cols_;
+}
+
+Matrix::Fingerprint Matrix::getFingerprint() const noexcept {
+  if (fingerprint_state_.load(std::memory_order_acquire) == kFingerprintReady)
+    return fingerprint_;
+  Fingerprint result{(size_t)rows_ * 0x9e3779b97f4a7c15ull ^ (size_t)cols_,
+                     0.0, 0.0, 0.0};
+  for (int i = 0; i < rows_; i++) {
+    for (int j = 0; j < cols_; j++) {
+      double value = matrix_[i][j];
+      result.sum += value;
+      result.alternating_sum += (i + j) % 2 ? -value : value;
+      result.abs_sum += fabs(value);
+      // FNV-1a по номерам шагов 1e-7; + 0.0 совмещает -0 и 0
+      double step = floor(value / kEqualityTolerance) + 0.0;
+      uint64_t bits;
+      memcpy(&bits, &step, sizeof(bits));
+      result.hash = (result.hash ^ bits) * 0x100000001b3ull;
     }
   }
+  // Запоминает только первый из одновременно считающих потоков. Если за
+  // это время была выдана ссылка на элемент, отпечаток не публикуется;
+  // вернуться к kFingerprintEmpty состояние может только при замене
+  // хранилища, которая не идёт параллельно с чтением.
+  int expected = kFingerprintEmpty;
+  if (fingerprint_state_.compare_exchange_strong(expected,
+                                                 kFingerprintComputing)) {
+    fingerprint_ = result;
+    expected = kFingerprintComputing;
+    fingerprint_state_.compare_exchange_strong(expected, kFingerprintReady,
+                                               std::memory_order_release);
+  }
+  return result;
+}
+
+void Matrix::Invalidate() const noexcept {
+  // Выданные через operator() ссылки по-прежнему указывают в хранилище
+  int state = fingerprint_state_.load(std::memory_order_relaxed);
+  while (state != kFingerprintEscaped &&
+         !fingerprint_state_.compare_exchange_weak(
+             state, kFingerprintEmpty, std::memory_order_relaxed)) {
+  }
 }
 
 double &Matrix::operator()(int i, int j) const {
   if (i < 0 || j < 0 || i > rows_ - 1 || j > cols_ - 1)
     throw std::out_of_range("Matrix out of range");
+  // Через ссылку элемент может измениться и после возврата
+  fingerprint_state_.store(kFingerprintEscaped, std::memory_order_relaxed);
   return matrix_[i][j];
 }
 
@@ -305,13 +1285,13 @@ Matrix &Matrix::operator=(const Matrix &other) {
     cols_ = other.cols_;
     // Выделение памяти для новой матрицы
     try {
-      this->AllocateMatrix();
+      this->AllocateMatrix(false);
     } catch (std::bad_alloc &e) {
       throw e;
     }
-    for (int i = 0; i < rows_; ++i) {
-      memcpy(matrix_[i], other.matrix_[i], cols_ * sizeof(double));
-    }
+    CopyRows(matrix_, other.matrix_, rows_, cols_);
+    // Хранилище новое, ссылок в него ещё нет
+    fingerprint_state_.store(kFingerprintEmpty, std::memory_order_relaxed);
   }
   return *this;
 }
@@ -322,9 +1302,15 @@ Matrix &Matrix::operator=(Matrix &&other) noexcept {
     matrix_ = other.matrix_;
     rows_ = other.rows_;
     cols_ = other.cols_;
+    adopted_ = other.adopted_;
+    fingerprint_state_ = other.fingerprint_state_.load();
+    fingerprint_ = other.fingerprint_;
     other.matrix_ = nullptr;
     other.rows_ = 0;
     other.cols_ = 0;
+    other.adopted_ = false;
+    other.fingerprint_state_.store(kFingerprintEmpty,
+                                   std::memory_order_relaxed);
   }
   return *this;
 }
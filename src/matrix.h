@@ -1,23 +1,87 @@
 #ifndef MATRIX_MATRIX_H_
 #define MATRIX_MATRIX_H_
 
+#include <atomic>
 #include <cmath>
+#include <cstddef>
 #include <cstring>
+#include <future>
 #include <iostream>
+#include <memory>
+
+#include "executor.h"
+
+struct EigenDecomposition;
+struct SingularValueDecomposition;
+
+// kMixed - LU-разложение во float с уточнением решения в double
+enum class Precision { kDouble, kMixed };
+
+// Размещение больших матриц по узлам NUMA: kFirstTouch - страница
+// попадает на узел потока, который первым к ней обратился (хранилище
+// обнуляется параллельно так же, как делится работа в умножении),
+// kInterleave - страницы чередуются по всем узлам, kBind - все на node
+enum class Placement { kFirstTouch, kInterleave, kBind };
+
+struct PlacementPolicy {
+  Placement placement = Placement::kFirstTouch;
+  int node = 0;
+  // Прозрачные большие страницы для больших матриц
+  bool huge_pages = true;
+};
+
+// Метка конструктора, который оставляет элементы неинициализированными:
+// для матриц, которые сразу целиком заполняются
+struct Uninitialized {
+  explicit Uninitialized() = default;
+};
+inline constexpr Uninitialized uninitialized{};
+
+struct RefinementInfo {
+  int iterations = 0;
+  bool fell_back = false;
+};
 
 class Matrix {
  public:
   Matrix();
   Matrix(int rows, int cols);
+  Matrix(int rows, int cols, Uninitialized);
   Matrix(const Matrix &other);
   Matrix(Matrix &&other) noexcept;
   ~Matrix();
 
+  static Matrix Identity(int size);
+  static Matrix Filled(int rows, int cols, double value);
+  // Копия непрерывного блока rows * cols элементов по строкам
+  static Matrix FromBuffer(int rows, int cols, const double *data);
+  // Забирает блок, выделенный через new double[rows * cols], без копирования
+  static Matrix FromBuffer(int rows, int cols, std::unique_ptr<double[]> data);
+  // Элемент (i, j) равен generator(i, j); обход по строкам
+  template <typename Generator>
+  static Matrix FromGenerator(int rows, int cols, Generator generator);
+
+  // Политика действует на матрицы, создаваемые после её установки
+  static void setPlacementPolicy(const PlacementPolicy &policy);
+  static PlacementPolicy getPlacementPolicy();
+  static int getNumaNodes() noexcept;
+
   int getRows() const noexcept;
   int getCols() const noexcept;
   void setRows(const int rows);
   void setCols(const int cols);
+  // Сравнение с точностью 1e-7 до первого различия. Если у обеих матриц
+  // уже сохранён отпечаток содержимого (его сохраняет getHash, например в
+  // MatrixCache), заметно различающиеся матрицы отличаются за O(1); сами
+  // сравнения отпечатков не считают.
   bool EqMatrix(const Matrix &other) const noexcept;
+  // Хеш содержимого, округлённого до шага 1e-7: у побитно равных матриц
+  // совпадает, у равных по EqMatrix - почти всегда. Считается за проход по
+  // матрице и сохраняется вместе с отпечатком, но не после operator() (в
+  // том числе только для чтения): выданная ссылка остаётся в хранилище до
+  // его замены (присваивание, MulMatrix, setRows, setCols). Матрицы из
+  // FromBuffer и FromGenerator отпечаток сохраняют.
+  size_t getHash() const noexcept;
   void SumMatrix(const Matrix &other);
   void SubMatrix(const Matrix &other);
   void MulNumber(const double num) noexcept;
@@ -26,6 +90,31 @@ class Matrix {
   double Determinant() const;
   Matrix CalcComplements() const;
   Matrix InverseMatrix() const;
+  Matrix InverseMatrix(Precision precision,
+                       RefinementInfo *info = nullptr) const;
+  Matrix Solve(const Matrix &other, Precision precision = Precision::kDouble,
+               RefinementInfo *info = nullptr) const;
+  // Возведение в целую степень (отрицательная - через обратную матрицу)
+  Matrix Pow(int power) const;
+  // Матричная экспонента
+  Matrix Exp() const;
+  EigenDecomposition EigenSymmetric(bool compute_vectors = true) const;
+  SingularValueDecomposition SVD(bool compute_vectors = true) const;
+  SingularValueDecomposition TruncatedSVD(int rank, int oversampling = 10,
+                                          int power_iterations = 2) const;
+
+  // Асинхронные варианты выполняются на Executor::Instance() над копиями
+  // операндов; исключения и отмена передаются через future
+  std::future<Matrix> MulAsync(
+      Matrix other, int priority = 0,
+      CancellationToken token = CancellationToken()) const;
+  std::future<Matrix> InverseAsync(
+      int priority = 0, CancellationToken token = CancellationToken()) const;
+  std::future<Matrix> SolveAsync(
+      Matrix other, Precision precision = Precision::kDouble,
+      int priority = 0, CancellationToken token = CancellationToken()) const;
+  std::future<double> DeterminantAsync(
+      int priority = 0, CancellationToken token = CancellationToken()) const;
 
   double &operator()(int i, int j) const;
 
@@ -43,10 +132,55 @@ class Matrix {
   Matrix &operator=(Matrix &&other) noexcept;
 
  private:
+  friend class CholeskyFactor;
+  friend class IncrementalInverse;
+  friend class LazyMatrix;
+
+  struct Fingerprint {
+    size_t hash;
+    double sum, alternating_sum, abs_sum;
+  };
+
   double **matrix_;
   int rows_, cols_;
+  // Хранилище получено через FromBuffer и освобождается delete[]
+  bool adopted_ = false;
+  mutable std::atomic<int> fingerprint_state_{0};
+  mutable Fingerprint fingerprint_{};
   Matrix Minor(int row, int column) const noexcept;
-  void AllocateMatrix();
+  // *this * other; при cancellable умножение прерывается отменой задания
+  // Async, из которого вызвано
+  Matrix Multiply(const Matrix &other, bool cancellable) const;
+  void AllocateMatrix(bool zero = true);
+  Fingerprint getFingerprint() const noexcept;
+  // Вызывается после записи на месте в уже существующую матрицу
+  void Invalidate() const noexcept;
+};
+
+template <typename Generator>
+Matrix Matrix::FromGenerator(int rows, int cols, Generator generator) {
+  Matrix result(rows, cols, uninitialized);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < cols; j++) {
+      result.matrix_[i][j] = generator(i, j);
+    }
+  }
+  return result;
+}
+
+// values - столбец n x 1 по возрастанию, vectors - собственные векторы
+// в столбцах (пустая матрица, если векторы не запрашивались)
+struct EigenDecomposition {
+  Matrix values;
+  Matrix vectors;
+};
+
+// Тонкое разложение A = U * diag(s) * V^T, s - столбец k x 1 по убыванию,
+// u (m x k) и v (n x k) пустые, если векторы не запрашивались
+struct SingularValueDecomposition {
+  Matrix u;
+  Matrix s;
+  Matrix v;
 };
 
 #endif  //MATRIXPLUS_MATRIX_H_
\ No newline at end of file
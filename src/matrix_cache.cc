@@ -0,0 +1,98 @@
+#include "matrix_cache.h"
+
+#include <iterator>
+#include <stdexcept>
+
+MatrixCache::MatrixCache(int capacity) : capacity_(capacity) {
+  if (capacity < 1)
+    throw std::out_of_range("The cache capacity must be positive");
+}
+
+Matrix MatrixCache::InverseMatrix(const Matrix &matrix) {
+  size_t hash = matrix.getHash();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Iterator entry = Find(matrix, hash);
+    if (entry != entries_.end() && entry->inverse) {
+      hits_++;
+      return *entry->inverse;
+    }
+    misses_++;
+  }
+  // Считается без блокировки; исключения не запоминаются
+  Matrix inverse = matrix.InverseMatrix();
+  std::lock_guard<std::mutex> lock(mutex_);
+  Store(matrix, hash)->inverse = inverse;
+  return inverse;
+}
+
+double MatrixCache::Determinant(const Matrix &matrix) {
+  size_t hash = matrix.getHash();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Iterator entry = Find(matrix, hash);
+    if (entry != entries_.end() && entry->determinant) {
+      hits_++;
+      return *entry->determinant;
+    }
+    misses_++;
+  }
+  double determinant = matrix.Determinant();
+  std::lock_guard<std::mutex> lock(mutex_);
+  Store(matrix, hash)->determinant = determinant;
+  return determinant;
+}
+
+int MatrixCache::getSize() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return (int)entries_.size();
+}
+
+int MatrixCache::getHits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+int MatrixCache::getMisses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+void MatrixCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  index_.clear();
+  entries_.clear();
+  hits_ = misses_ = 0;
+}
+
+MatrixCache::Iterator MatrixCache::Find(const Matrix &matrix, size_t hash) {
+  auto range = index_.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second->matrix == matrix) {
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return it->second;
+    }
+  }
+  return entries_.end();
+}
+
+MatrixCache::Iterator MatrixCache::Store(const Matrix &matrix, size_t hash) {
+  Iterator entry = Find(matrix, hash);
+  if (entry != entries_.end()) return entry;
+  entries_.push_front(Entry{hash, matrix, std::nullopt, std::nullopt});
+  // Отпечаток копии считается сразу, чтобы последующие сравнения с ней
+  // отсекали несовпадения за O(1)
+  entries_.front().matrix.getHash();
+  index_.emplace(hash, entries_.begin());
+  if ((int)entries_.size() > capacity_) {
+    auto range = index_.equal_range(entries_.back().hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == std::prev(entries_.end())) {
+        index_.erase(it);
+        break;
+      }
+    }
+    entries_.pop_back();
+  }
+  return entries_.begin();
+}
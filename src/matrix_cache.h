@@ -0,0 +1,47 @@
+#ifndef MATRIX_MATRIX_CACHE_H_
+#define MATRIX_MATRIX_CACHE_H_
+
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include "matrix.h"
+
+// Запоминает результаты дорогих операций для повторяющихся входов. Вход
+// ищется по getHash() и сравнивается через EqMatrix, то есть результат
+// возвращается и для матрицы, равной запомненной с точностью 1e-7. При
+// переполнении вытесняется дольше всего не использованная запись.
+// Методы можно вызывать из разных потоков.
+class MatrixCache {
+ public:
+  explicit MatrixCache(int capacity = 64);
+
+  Matrix InverseMatrix(const Matrix &matrix);
+  double Determinant(const Matrix &matrix);
+
+  int getSize() const;
+  int getHits() const;
+  int getMisses() const;
+  void Clear();
+
+ private:
+  struct Entry {
+    size_t hash;
+    Matrix matrix;
+    std::optional<Matrix> inverse;
+    std::optional<double> determinant;
+  };
+  using Iterator = std::list<Entry>::iterator;
+
+  Iterator Find(const Matrix &matrix, size_t hash);
+  Iterator Store(const Matrix &matrix, size_t hash);
+
+  mutable std::mutex mutex_;
+  int capacity_, hits_ = 0, misses_ = 0;
+  // В порядке использования, последняя использованная - первая
+  std::list<Entry> entries_;
+  std::unordered_multimap<size_t, Iterator> index_;
+};
+
+#endif  // MATRIX_MATRIX_CACHE_H_
@@ -0,0 +1,147 @@
+#include "storage.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+
+#include "executor.h"
+#include "kernels.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace storage {
+
+namespace {
+
+// Режимы mbind из <numaif.h>; вызывается напрямую, без libnuma
+const int kBindMode = 2;
+const int kInterleaveMode = 3;
+const int kMaxNodes = 1024;
+
+std::mutex policy_mutex;
+PlacementPolicy policy;
+
+size_t Bytes(int rows, int cols) {
+  return (size_t)rows * cols * sizeof(double);
+}
+
+// Страницы большого блока при kFirstTouch размещаются по узлам, только
+// если его заполняют несколько потоков
+bool SpreadPages(size_t bytes, const PlacementPolicy &current) {
+  return bytes >= kLargeBuffer &&
+         current.placement == Placement::kFirstTouch &&
+         Executor::Instance().getThreadCount() > 1;
+}
+
+#ifdef __linux__
+void Place(void *data, size_t bytes, const PlacementPolicy &current) {
+  if (current.huge_pages) madvise(data, bytes, MADV_HUGEPAGE);
+  if (current.placement == Placement::kFirstTouch) return;
+  unsigned long mask[kMaxNodes / (8 * sizeof(unsigned long))] = {};
+  const int bits = 8 * sizeof(unsigned long);
+  int mode = kBindMode;
+  if (current.placement == Placement::kInterleave) {
+    mode = kInterleaveMode;
+    for (int node = 0; node < getNodeCount(); node++)
+      mask[node / bits] |= 1ul << (node % bits);
+  } else {
+    mask[current.node / bits] |= 1ul << (current.node % bits);
+  }
+  // Без поддержки NUMA в ядре вызов не удаётся, и страницы размещаются
+  // как обычно
+  syscall(SYS_mbind, data, bytes, mode, mask, kMaxNodes + 1, 0);
+}
+#endif
+
+}  // namespace
+
+double *Allocate(int rows, int cols, bool zero) {
+  size_t bytes = Bytes(rows, cols);
+#ifdef __linux__
+  if (bytes >= kLargeBuffer) {
+    void *data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) throw std::bad_alloc();
+    PlacementPolicy current = getPolicy();
+    Place(data, bytes, current);
+    // Страницы отображения уже нулевые, запись лишь размещает их
+    if (zero && SpreadPages(bytes, current)) {
+      double *values = static_cast<double *>(data);
+      try {
+        Executor::Instance().ParallelFor(
+            0, rows, kernels::RowGrain(rows), [=](int begin, int end) {
+              std::fill(values + (size_t)begin * cols,
+                        values + (size_t)end * cols, 0.0);
+            });
+      } catch (...) {
+        munmap(data, bytes);
+        throw;
+      }
+    }
+    return static_cast<double *>(data);
+  }
+#endif
+  if (!zero) return new double[(size_t)rows * cols];
+  return new double[(size_t)rows * cols]{};
+}
+
+void Free(double *data, int rows, int cols) noexcept {
+  size_t bytes = Bytes(rows, cols);
+#ifdef __linux__
+  if (bytes >= kLargeBuffer) {
+    munmap(data, bytes);
+    return;
+  }
+#endif
+  delete[] data;
+}
+
+void Fill(int rows, int cols, const std::function<void(int, int)> &fill) {
+  if (SpreadPages(Bytes(rows, cols), getPolicy())) {
+    Executor::Instance().ParallelFor(0, rows, kernels::RowGrain(rows), fill);
+  } else if (rows > 0) {
+    fill(0, rows);
+  }
+}
+
+void setPolicy(const PlacementPolicy &value) {
+  if (value.placement == Placement::kBind &&
+      (value.node < 0 || value.node >= getNodeCount()))
+    throw std::out_of_range("There is no such NUMA node");
+  std::lock_guard<std::mutex> lock(policy_mutex);
+  policy = value;
+}
+
+PlacementPolicy getPolicy() {
+  std::lock_guard<std::mutex> lock(policy_mutex);
+  return policy;
+}
+
+int getNodeCount() noexcept {
+  static const int count = [] {
+    int nodes = 1;
+#ifdef __linux__
+    // Список вида "0-1" или "0,2-3"; нужен наибольший номер
+    if (FILE *file = fopen("/sys/devices/system/node/online", "r")) {
+      int value, last = 0, read;
+      char separator;
+      while ((read = fscanf(file, "%d%c", &value, &separator)) >= 1) {
+        last = value;
+        if (read == 1) break;
+      }
+      fclose(file);
+      nodes = std::min(kMaxNodes, last + 1);
+    }
+#endif
+    return nodes;
+  }();
+  return count;
+}
+
+}  // namespace storage
@@ -0,0 +1,36 @@
+#ifndef MATRIX_STORAGE_H_
+#define MATRIX_STORAGE_H_
+
+#include <cstddef>
+#include <functional>
+
+#include "matrix.h"
+
+// Выделение хранилища матриц с учётом PlacementPolicy
+namespace storage {
+
+// Буферы от этого размера (в байтах) берутся у системы отдельным
+// отображением страниц, чтобы к ним можно было применить политику NUMA
+// и прозрачные большие страницы
+const size_t kLargeBuffer = 1 << 21;
+
+// Блок rows x cols, обнулённый при zero. Для kFirstTouch большой блок
+// обнуляется параллельно по тем же отрезкам строк, что и в ParallelGemm,
+// чтобы страницы оказались на узлах потоков, которые будут с ними
+// работать; без zero страницы размещает первая запись заполняющего кода.
+double *Allocate(int rows, int cols, bool zero = true);
+void Free(double *data, int rows, int cols) noexcept;
+// Заполнение блока rows x cols, где fill(begin, end) пишет строки
+// [begin, end). Большой блок при kFirstTouch заполняется параллельно по
+// тем же отрезкам, что и при обнулении в Allocate; иначе fill вызывается
+// один раз для всех строк.
+void Fill(int rows, int cols, const std::function<void(int, int)> &fill);
+
+void setPolicy(const PlacementPolicy &policy);
+PlacementPolicy getPolicy();
+// Число узлов NUMA (1, если система их не различает)
+int getNodeCount() noexcept;
+
+}  // namespace storage
+
+#endif  // MATRIX_STORAGE_H_
@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "../executor.h"
+#include "../incremental.h"
+#include "../kernels.h"
+#include "../lazy_matrix.h"
+#include "../matrix.h"
+#include "../matrix_cache.h"
+
+namespace {
+
+Matrix RandomMatrix(int rows, int cols, unsigned seed) {
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  Matrix result(rows, cols);
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < cols; ++j) {
+      result(i, j) = uniform(generator);
+    }
+  }
+  return result;
+}
+
+template <typename Function>
+double Seconds(Function function) {
+  auto start = std::chrono::steady_clock::now();
+  function();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+bool Selected(const char *filter, const char *name) {
+  return !filter || !strcmp(filter, "all") || !strcmp(filter, name);
+}
+
+void BenchDecomposition(int max_size) {
+  printf("%-6s %12s %12s %12s %12s %12s\n", "n", "eig values", "eig vectors",
+         "svd values", "svd vectors", "top-10 svd");
+  for (int n : {100, 250, 500, 1000, 2000}) {
+    if (n > max_size) break;
+    Matrix random = RandomMatrix(n, n, n);
+    Matrix symmetric = random + random.Transpose();
+    printf("%-6d %12.3f %12.3f %12.3f %12.3f %12.3f\n", n,
+           Seconds([&] { symmetric.EigenSymmetric(false); }),
+           Seconds([&] { symmetric.EigenSymmetric(); }),
+           Seconds([&] { random.SVD(false); }),
+           Seconds([&] { random.SVD(); }),
+           Seconds([&] { random.TruncatedSVD(10); }));
+  }
+}
+
+void BenchRefinement(int max_size) {
+  printf("%-6s %10s %10s %8s %5s %10s %10s %8s %5s\n", "n", "solve f64",
+         "solve mix", "speedup", "iter", "inv f64", "inv mix", "speedup",
+         "iter");
+  for (int n : {250, 500, 1000, 2000}) {
+    if (n > max_size) break;
+    Matrix matrix = RandomMatrix(n, n, n);
+    for (int i = 0; i < n; ++i) matrix(i, i) += n;
+    Matrix right = RandomMatrix(n, 1, n + 1);
+    RefinementInfo solve_info, inverse_info;
+    double solve_double =
+        Seconds([&] { matrix.Solve(right, Precision::kDouble); });
+    double solve_mixed = Seconds(
+        [&] { matrix.Solve(right, Precision::kMixed, &solve_info); });
+    double inverse_double =
+        Seconds([&] { matrix.InverseMatrix(Precision::kDouble); });
+    double inverse_mixed = Seconds(
+        [&] { matrix.InverseMatrix(Precision::kMixed, &inverse_info); });
+    printf("%-6d %10.3f %10.3f %7.2fx %5d %10.3f %10.3f %7.2fx %5d\n", n,
+           solve_double, solve_mixed, solve_double / solve_mixed,
+           solve_info.iterations, inverse_double, inverse_mixed,
+           inverse_double / inverse_mixed, inverse_info.iterations);
+  }
+}
+
+// Сильная масштабируемость блочного LU (через Determinant) по числу потоков
+void BenchLu(int max_size) {
+  Executor &executor = Executor::Instance();
+  int default_threads = executor.getThreadCount();
+  printf("%-6s %8s %10s %10s %8s\n", "n", "threads", "seconds", "GFLOP/s",
+         "speedup");
+  for (int n : {1024, 2048, 4096, 8192}) {
+    if (n > max_size) break;
+    Matrix matrix = RandomMatrix(n, n, n);
+    double flops = 2.0 / 3.0 * n * n * n, serial = 0;
+    for (int threads : {1, 2, 4, 8, 16, 32, 64}) {
+      executor.setThreadCount(threads);
+      double seconds = Seconds([&] { matrix.Determinant(); });
+      if (threads == 1) serial = seconds;
+      printf("%-6d %8d %10.3f %10.2f %7.2fx\n", n, threads, seconds,
+             flops / seconds * 1e-9, serial / seconds);
+    }
+  }
+  executor.setThreadCount(default_threads);
+}
+
+// Конвейер: загрузка следующего входа (здесь - генерация) перекрывается
+// с обращением текущей матрицы через InverseAsync
+void BenchAsync(int max_size) {
+  const int jobs = 8;
+  printf("%-6s %12s %12s %8s\n", "n", "blocking", "pipelined", "speedup");
+  for (int n : {250, 500, 1000}) {
+    if (n > max_size) break;
+    double blocking = Seconds([&] {
+      for (int job = 0; job < jobs; ++job) {
+        RandomMatrix(n, n, job).InverseMatrix();
+      }
+    });
+    double pipelined = Seconds([&] {
+      std::future<Matrix> pending = RandomMatrix(n, n, 0).InverseAsync();
+      for (int job = 1; job <= jobs; ++job) {
+        Matrix next = job < jobs ? RandomMatrix(n, n, job) : Matrix();
+        pending.get();
+        if (job < jobs) pending = next.InverseAsync();
+      }
+    });
+    printf("%-6d %12.3f %12.3f %7.2fx\n", n, blocking, pipelined,
+           blocking / pipelined);
+  }
+}
+
+// Выражение (A * B)^T + 2 * (A * B) - C: по шагам и через LazyMatrix
+void BenchLazy(int max_size) {
+  printf("%-6s %12s %12s %8s %6s %6s\n", "n", "eager", "lazy", "speedup",
+         "gemm", "passes");
+  for (int n : {256, 512, 1024, 2048}) {
+    if (n > max_size) break;
+    Matrix a = RandomMatrix(n, n, 1), b = RandomMatrix(n, n, 2),
+           c = RandomMatrix(n, n, 3);
+    double eager = Seconds([&] {
+      Matrix product = a * b;
+      Matrix result = product.Transpose() + product * 2.0 - c;
+    });
+    EvaluationInfo info;
+    double lazy = Seconds([&] {
+      LazyMatrix product = LazyMatrix(a) * LazyMatrix(b);
+      Matrix result =
+          (product.Transpose() + product * 2.0 - LazyMatrix(c)).Evaluate(&info);
+    });
+    printf("%-6d %12.3f %12.3f %7.2fx %6d %6d\n", n, eager, lazy, eager / lazy,
+           info.products, info.passes);
+  }
+}
+
+// A^k для стохастической матрицы (цепь Маркова): k умножений через *=
+// против возведения в степень, плюс время Exp()
+void BenchPower(int max_size) {
+  const int n = std::min(512, max_size);
+  Matrix transition = RandomMatrix(n, n, 1);
+  for (int i = 0; i < n; ++i) {
+    double sum = 0;
+    for (int j = 0; j < n; ++j) {
+      transition(i, j) = fabs(transition(i, j));
+      sum += transition(i, j);
+    }
+    for (int j = 0; j < n; ++j) transition(i, j) /= sum;
+  }
+  printf("n = %d\n%-8s %12s %12s\n", n, "k", "*= loop", "Pow");
+  for (int k : {10, 100, 1000, 10000, 100000, 1000000}) {
+    double loop = -1;
+    if (k <= 100) {
+      loop = Seconds([&] {
+        Matrix power = transition;
+        for (int i = 1; i < k; ++i) power *= transition;
+      });
+    }
+    double fast = Seconds([&] { transition.Pow(k); });
+    if (loop < 0) {
+      printf("%-8d %12s %12.3f\n", k, "-", fast);
+    } else {
+      printf("%-8d %12.3f %12.3f\n", k, loop, fast);
+    }
+  }
+  printf("%-8s %12s\n", "norm", "Exp");
+  for (double norm : {0.01, 1.0, 100.0}) {
+    Matrix generator = transition * (norm / n);
+    printf("%-8g %12.3f\n", norm, Seconds([&] { generator.Exp(); }));
+  }
+}
+
+// Замена одной строки: обновление обратной за O(n^2) против InverseMatrix()
+void BenchIncremental(int max_size) {
+  const int updates = 10;
+  printf("%-6s %12s %12s %8s\n", "n", "inverse", "update", "speedup");
+  for (int n : {256, 512, 1024, 2048}) {
+    if (n > max_size) break;
+    Matrix matrix = RandomMatrix(n, n, 1);
+    for (int i = 0; i < n; ++i) matrix(i, i) += n;
+    IncrementalInverse inverse(matrix);
+    Matrix rows = RandomMatrix(updates, n, 2);
+    double full = Seconds([&] {
+      for (int k = 0; k < updates; ++k) {
+        for (int j = 0; j < n; ++j) matrix(k, j) = rows(k, j) + (k == j) * n;
+        matrix.InverseMatrix();
+      }
+    });
+    double incremental = Seconds([&] {
+      for (int k = 0; k < updates; ++k) {
+        Matrix row(1, n);
+        for (int j = 0; j < n; ++j) row(0, j) = matrix(k, j);
+        inverse.UpdateRow(k, row);
+      }
+    });
+    printf("%-6d %12.3f %12.3f %7.1fx\n", n, full / updates,
+           incremental / updates, full / incremental);
+  }
+}
+
+// Поиск дубликатов среди матриц, различающихся только последней строкой:
+// поэлементное сравнение против сравнения с отпечатками, затем повторный
+// InverseMatrix() через MatrixCache
+void BenchFingerprint(int max_size) {
+  const int count = 100;
+  printf("%-6s %12s %12s %8s %12s %12s\n", "n", "scan", "fingerprint",
+         "speedup", "inverse", "cache hit");
+  for (int n : {128, 256, 512}) {
+    if (n > max_size) break;
+    // Матрицы собираются через FromBuffer: после operator() отпечаток не
+    // хранится. Буферы остаются для прохода без отпечатков.
+    Matrix base = RandomMatrix(n, n, 1);
+    std::vector<std::vector<double>> buffers(count);
+    std::vector<Matrix> matrices;
+    for (int k = 0; k < count; ++k) {
+      Matrix row = RandomMatrix(1, n, k + 2);
+      buffers[k].resize((size_t)n * n);
+      for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+          buffers[k][(size_t)i * n + j] = i == n - 1 ? row(0, j) : base(i, j);
+        }
+      }
+      matrices.push_back(Matrix::FromBuffer(n, n, buffers[k].data()));
+    }
+    int duplicates = 0;
+    double scan = Seconds([&] {
+      for (int a = 0; a < count; ++a) {
+        for (int b = 0; b < a; ++b) {
+          // Строки лежат подряд, как в EqMatrix без отпечатков
+          const double *x = buffers[a].data(), *y = buffers[b].data();
+          int k = 0;
+          while (k < n * n && fabs(x[k] - y[k]) <= 1e-7) k++;
+          duplicates += k == n * n;
+        }
+      }
+    });
+    // Отпечатки сохраняет getHash; его проход входит в замер
+    double fingerprint = Seconds([&] {
+      for (const Matrix &matrix : matrices) matrix.getHash();
+      for (int a = 0; a < count; ++a) {
+        for (int b = 0; b < a; ++b) duplicates += matrices[a] == matrices[b];
+      }
+    });
+    MatrixCache cache;
+    double inverse = Seconds([&] { cache.InverseMatrix(matrices[0]); });
+    double hit = Seconds([&] { cache.InverseMatrix(matrices[0]); });
+    printf("%-6d %12.4f %12.4f %7.1fx %12.4f %12.4f\n", n, scan, fingerprint,
+           scan / fingerprint, inverse, hit);
+    if (duplicates) printf("unexpected duplicates: %d\n", duplicates);
+  }
+}
+
+// Создание большой матрицы и пропускная способность параллельного чтения
+// и записи по строкам (теми же отрезками, что и в умножении) для каждой
+// политики размещения
+void BenchPlacement(int max_size) {
+  const int n = std::min(4096, max_size), passes = 5;
+  const double gigabytes = (double)n * n * sizeof(double) / 1e9;
+  const char *names[] = {"first-touch", "interleave", "bind"};
+  Executor &executor = Executor::Instance();
+  printf("n = %d, threads = %d, numa nodes = %d\n", n,
+         executor.getThreadCount(), Matrix::getNumaNodes());
+  printf("%-12s %6s %12s %12s %12s\n", "policy", "thp", "create, s",
+         "read, GB/s", "write, GB/s");
+  PlacementPolicy saved = Matrix::getPlacementPolicy();
+  for (Placement placement :
+       {Placement::kFirstTouch, Placement::kInterleave, Placement::kBind}) {
+    for (bool huge_pages : {false, true}) {
+      PlacementPolicy policy;
+      policy.placement = placement;
+      policy.huge_pages = huge_pages;
+      Matrix::setPlacementPolicy(policy);
+      Matrix matrix;
+      double create = Seconds([&] { matrix = Matrix(n, n); });
+      double *data = &matrix(0, 0);
+      std::vector<double> sums(n);
+      auto rows = [&](const std::function<void(int, int)> &body) {
+        executor.ParallelFor(0, n, kernels::RowGrain(n), body);
+      };
+      double read = Seconds([&] {
+        for (int pass = 0; pass < passes; ++pass) {
+          rows([&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+              const double *row = data + (size_t)i * n;
+              sums[i] = std::accumulate(row, row + n, 0.0);
+            }
+          });
+        }
+      });
+      double write = Seconds([&] {
+        for (int pass = 0; pass < passes; ++pass) {
+          rows([&](int begin, int end) {
+            std::fill(data + (size_t)begin * n, data + (size_t)end * n,
+                      (double)pass);
+          });
+        }
+      });
+      printf("%-12s %6s %12.3f %12.2f %12.2f\n",
+             names[static_cast<int>(placement)], huge_pages ? "yes" : "no",
+             create, passes * gigabytes / read, passes * gigabytes / write);
+    }
+  }
+  Matrix::setPlacementPolicy(saved);
+}
+
+// Создание матрицы, которая сразу целиком заполняется: с обнулением,
+// без него и через FromGenerator; плюс Transpose, которая теперь не
+// обнуляет результат
+void BenchConstruction(int max_size) {
+  const int repeats = 10;
+  printf("%-6s %12s %12s %12s %12s\n", "n", "zeroed, ms", "uninit, ms",
+         "generator", "transpose");
+  for (int n : {256, 512, 1024, 2048, 4096}) {
+    if (n > max_size) break;
+    auto fill = [n](Matrix &matrix) {
+      double *data = &matrix(0, 0);
+      for (size_t k = 0; k < (size_t)n * n; ++k) data[k] = (double)k;
+    };
+    double zeroed = Seconds([&] {
+      for (int r = 0; r < repeats; ++r) {
+        Matrix matrix(n, n);
+        fill(matrix);
+      }
+    });
+    double raw = Seconds([&] {
+      for (int r = 0; r < repeats; ++r) {
+        Matrix matrix(n, n, uninitialized);
+        fill(matrix);
+      }
+    });
+    double generator = Seconds([&] {
+      for (int r = 0; r < repeats; ++r) {
+        Matrix::FromGenerator(n, n, [n](int i, int j) {
+          return (double)((size_t)i * n + j);
+        });
+      }
+    });
+    Matrix source = RandomMatrix(n, n, 1);
+    double transpose = Seconds([&] {
+      for (int r = 0; r < repeats; ++r) source.Transpose();
+    });
+    printf("%-6d %12.3f %12.3f %12.3f %12.3f\n", n, 1e3 * zeroed / repeats,
+           1e3 * raw / repeats, 1e3 * generator / repeats,
+           1e3 * transpose / repeats);
+  }
+}
+
+}  // namespace
+
+// Использование: bench [раздел|all] [максимальный размер]
+int main(int argc, char **argv) {
+  const char *filter = argc > 1 ? argv[1] : nullptr;
+  int max_size = argc > 2 ? atoi(argv[2]) : INT_MAX;
+  if (Selected(filter, "decomposition")) BenchDecomposition(max_size);
+  if (Selected(filter, "refinement")) BenchRefinement(max_size);
+  if (Selected(filter, "lu")) BenchLu(max_size);
+  if (Selected(filter, "async")) BenchAsync(max_size);
+  if (Selected(filter, "lazy")) BenchLazy(max_size);
+  if (Selected(filter, "power")) BenchPower(max_size);
+  if (Selected(filter, "incremental")) BenchIncremental(max_size);
+  if (Selected(filter, "fingerprint")) BenchFingerprint(max_size);
+  if (Selected(filter, "placement")) BenchPlacement(max_size);
+  if (Selected(filter, "construction")) BenchConstruction(max_size);
+  return 0;
+}
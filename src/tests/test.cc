@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
 
+#include "../executor.h"
+#include "../incremental.h"
+#include "../lazy_matrix.h"
 #include "../matrix.h"
+#include "../matrix_cache.h"
 
 TEST(TestGroupMatrix, wrong_constructor) {
   EXPECT_ANY_THROW(Matrix matrix(-7, -1));
@@ -146,9 +150,10 @@ TEST(TestGroupMatrix, determinant) {
       matrix(i, j) = values[i][j];
     }
   }
-  EXPECT_EQ(matrix.Determinant(), -1);
+  EXPECT_NEAR(matrix.Determinant(), -1, 1e-12);
   Matrix tmp(1, 7);
   EXPECT_ANY_THROW(tmp.Determinant());
+  EXPECT_EQ(Matrix().Determinant(), 0);
 }
 
 TEST(test_overload, transpose) {
@@ -225,6 +230,7 @@ TEST(test_overload, inverse_matrix) {
   EXPECT_TRUE(matrix == inverse_matrix);
   Matrix tmp(1, 7);
   EXPECT_ANY_THROW(tmp.InverseMatrix());
+  EXPECT_THROW(Matrix().InverseMatrix(), std::logic_error);
 }
 
 TEST(test_overload, mul_matrix) {
@@ -495,6 +501,934 @@ TEST(test_overload, sum_eq_matrix) {
   EXPECT_TRUE(matrix_1 == matrix_answer);
 }
 
+TEST(test_overload, transpose_rectangular) {
+  double values[2][3] = {
+      {1, 2, 3},
+      {4, 5, 6},
+  };
+  Matrix matrix(2, 3);
+  for (int i = 0; i < matrix.getRows(); ++i) {
+    for (int j = 0; j < matrix.getCols(); ++j) {
+      matrix(i, j) = values[i][j];
+    }
+  }
+  Matrix matrix_transpose = matrix.Transpose();
+  EXPECT_EQ(matrix_transpose.getRows(), 3);
+  EXPECT_EQ(matrix_transpose.getCols(), 2);
+  EXPECT_EQ(matrix_transpose(2, 1), 6);
+}
+
+TEST(test_overload, mul_matrix_rectangular) {
+  double values[2][3] = {
+      {1, 2, 3},
+      {4, 5, 6},
+  };
+  Matrix matrix(2, 3);
+  for (int i = 0; i < matrix.getRows(); ++i) {
+    for (int j = 0; j < matrix.getCols(); ++j) {
+      matrix(i, j) = values[i][j];
+    }
+  }
+  Matrix result = matrix * matrix.Transpose();
+  EXPECT_EQ(result.getRows(), 2);
+  EXPECT_EQ(result.getCols(), 2);
+  EXPECT_EQ(result(0, 0), 14);
+  EXPECT_EQ(result(0, 1), 32);
+  EXPECT_EQ(result(1, 1), 77);
+}
+
+TEST(test_decomposition, eigen_symmetric) {
+  double values[3][3] = {
+      {2, -1, 0},
+      {-1, 2, -1},
+      {0, -1, 2},
+  };
+  Matrix matrix(3, 3);
+  for (int i = 0; i < matrix.getRows(); ++i) {
+    for (int j = 0; j < matrix.getCols(); ++j) {
+      matrix(i, j) = values[i][j];
+    }
+  }
+  EigenDecomposition eigen = matrix.EigenSymmetric();
+  EXPECT_NEAR(eigen.values(0, 0), 2 - sqrt(2), 1e-12);
+  EXPECT_NEAR(eigen.values(1, 0), 2, 1e-12);
+  EXPECT_NEAR(eigen.values(2, 0), 2 + sqrt(2), 1e-12);
+  Matrix diagonal(3, 3);
+  Matrix identity(3, 3);
+  for (int i = 0; i < 3; ++i) {
+    diagonal(i, i) = eigen.values(i, 0);
+    identity(i, i) = 1;
+  }
+  EXPECT_TRUE(matrix * eigen.vectors == eigen.vectors * diagonal);
+  EXPECT_TRUE(eigen.vectors.Transpose() * eigen.vectors == identity);
+  EigenDecomposition values_only = matrix.EigenSymmetric(false);
+  EXPECT_TRUE(values_only.values == eigen.values);
+  EXPECT_EQ(values_only.vectors.getRows(), 0);
+  matrix(0, 1) = 5;
+  EXPECT_ANY_THROW(matrix.EigenSymmetric());
+  Matrix tmp(1, 7);
+  EXPECT_ANY_THROW(tmp.EigenSymmetric());
+  EXPECT_THROW(Matrix().EigenSymmetric(), std::length_error);
+}
+
+TEST(test_decomposition, svd) {
+  double values[4][3] = {
+      {2, 5, 7},
+      {6, 3, 4},
+      {5, -2, -3},
+      {1, 0, 8},
+  };
+  Matrix matrix(4, 3);
+  for (int i = 0; i < matrix.getRows(); ++i) {
+    for (int j = 0; j < matrix.getCols(); ++j) {
+      matrix(i, j) = values[i][j];
+    }
+  }
+  for (const Matrix &input : {matrix, matrix.Transpose()}) {
+    SingularValueDecomposition svd = input.SVD();
+    EXPECT_EQ(svd.s.getRows(), 3);
+    Matrix diagonal(3, 3);
+    Matrix identity(3, 3);
+    for (int i = 0; i < 3; ++i) {
+      diagonal(i, i) = svd.s(i, 0);
+      identity(i, i) = 1;
+      if (i > 0) {
+        EXPECT_GE(svd.s(i - 1, 0), svd.s(i, 0));
+      }
+    }
+    EXPECT_TRUE(svd.u * diagonal * svd.v.Transpose() == input);
+    EXPECT_TRUE(svd.u.Transpose() * svd.u == identity);
+    EXPECT_TRUE(svd.v.Transpose() * svd.v == identity);
+    EXPECT_TRUE(input.SVD(false).s == svd.s);
+  }
+}
+
+TEST(test_decomposition, svd_rank_deficient) {
+  Matrix matrix(3, 3);
+  for (int i = 0; i < matrix.getRows(); ++i) {
+    for (int j = 0; j < matrix.getCols(); ++j) {
+      matrix(i, j) = (i + 1) * (j + 2);
+    }
+  }
+  SingularValueDecomposition svd = matrix.SVD();
+  EXPECT_NEAR(svd.s(1, 0), 0, 1e-12);
+  EXPECT_NEAR(svd.s(2, 0), 0, 1e-12);
+  Matrix identity(3, 3);
+  for (int i = 0; i < 3; ++i) identity(i, i) = 1;
+  EXPECT_TRUE(svd.u.Transpose() * svd.u == identity);
+}
+
+TEST(test_decomposition, truncated_svd) {
+  Matrix left(40, 2);
+  Matrix right(2, 30);
+  for (int i = 0; i < 40; ++i) {
+    left(i, 0) = sin(i);
+    left(i, 1) = cos(3 * i);
+  }
+  for (int j = 0; j < 30; ++j) {
+    right(0, j) = j % 7 - 3;
+    right(1, j) = 0.5 * j;
+  }
+  Matrix matrix = left * right;
+  SingularValueDecomposition exact = matrix.SVD(false);
+  SingularValueDecomposition svd = matrix.TruncatedSVD(2);
+  EXPECT_EQ(svd.u.getCols(), 2);
+  EXPECT_EQ(svd.v.getRows(), 30);
+  EXPECT_NEAR(svd.s(0, 0), exact.s(0, 0), 1e-9);
+  EXPECT_NEAR(svd.s(1, 0), exact.s(1, 0), 1e-9);
+  Matrix diagonal(2, 2);
+  diagonal(0, 0) = svd.s(0, 0);
+  diagonal(1, 1) = svd.s(1, 0);
+  EXPECT_TRUE(svd.u * diagonal * svd.v.Transpose() == matrix);
+  EXPECT_ANY_THROW(matrix.TruncatedSVD(0));
+  EXPECT_ANY_THROW(matrix.TruncatedSVD(31));
+}
+
+TEST(test_solve, solve) {
+  double values[3][3] = {
+      {2, 5, 7},
+      {6, 3, 4},
+      {5, -2, -3},
+  };
+  Matrix matrix(3, 3);
+  for (int i = 0; i < matrix.getRows(); ++i) {
+    for (int j = 0; j < matrix.getCols(); ++j) {
+      matrix(i, j) = values[i][j];
+    }
+  }
+  Matrix right(3, 1);
+  right(0, 0) = 1;
+  right(1, 0) = 2;
+  right(2, 0) = 3;
+  Matrix solution = matrix.Solve(right);
+  EXPECT_NEAR(solution(0, 0), 2, 1e-12);
+  EXPECT_NEAR(solution(1, 0), -58, 1e-12);
+  EXPECT_NEAR(solution(2, 0), 41, 1e-12);
+  RefinementInfo info;
+  Matrix mixed = matrix.Solve(right, Precision::kMixed, &info);
+  EXPECT_TRUE(mixed == solution);
+  EXPECT_FALSE(info.fell_back);
+  Matrix tmp(1, 7);
+  EXPECT_ANY_THROW(tmp.Solve(right));
+  EXPECT_ANY_THROW(matrix.Solve(tmp));
+  Matrix singular(2, 2);
+  EXPECT_ANY_THROW(singular.Solve(Matrix(2, 1)));
+  EXPECT_ANY_THROW(singular.Solve(Matrix(2, 1), Precision::kMixed));
+}
+
+TEST(test_solve, mixed_refinement) {
+  Matrix matrix(50, 50);
+  for (int i = 0; i < matrix.getRows(); ++i) {
+    for (int j = 0; j < matrix.getCols(); ++j) {
+      matrix(i, j) = sin(i * 50 + j) + (i == j ? 10 : 0);
+    }
+  }
+  RefinementInfo info;
+  Matrix inverse = matrix.InverseMatrix(Precision::kMixed, &info);
+  EXPECT_FALSE(info.fell_back);
+  EXPECT_GT(info.iterations, 0);
+  Matrix identity(50, 50);
+  for (int i = 0; i < 50; ++i) identity(i, i) = 1;
+  Matrix product = matrix * inverse;
+  for (int i = 0; i < 50; ++i) {
+    for (int j = 0; j < 50; ++j) {
+      EXPECT_NEAR(product(i, j), identity(i, j), 1e-13);
+    }
+  }
+  EXPECT_TRUE(inverse == matrix.InverseMatrix(Precision::kDouble));
+  // Порог вырожденности и пустая матрица - как у InverseMatrix()
+  Matrix small = Matrix::Identity(4) * 0.01;
+  EXPECT_THROW(small.InverseMatrix(), std::logic_error);
+  EXPECT_THROW(small.InverseMatrix(Precision::kDouble), std::logic_error);
+  EXPECT_THROW(small.InverseMatrix(Precision::kMixed), std::logic_error);
+  Matrix above = Matrix::Identity(4) * 0.04;
+  EXPECT_TRUE(above.InverseMatrix(Precision::kDouble) ==
+              above.InverseMatrix());
+  EXPECT_TRUE(above.InverseMatrix(Precision::kMixed) == above.InverseMatrix());
+  EXPECT_THROW(Matrix().InverseMatrix(), std::logic_error);
+  EXPECT_THROW(Matrix().InverseMatrix(Precision::kDouble), std::logic_error);
+  EXPECT_THROW(Matrix().InverseMatrix(Precision::kMixed), std::logic_error);
+}
+
+TEST(test_solve, mixed_fallback) {
+  Matrix hilbert(10, 10);
+  Matrix right(10, 1);
+  for (int i = 0; i < hilbert.getRows(); ++i) {
+    for (int j = 0; j < hilbert.getCols(); ++j) {
+      hilbert(i, j) = 1.0 / (i + j + 1);
+      right(i, 0) += hilbert(i, j);
+    }
+  }
+  RefinementInfo info;
+  Matrix solution = hilbert.Solve(right, Precision::kMixed, &info);
+  EXPECT_TRUE(info.fell_back);
+  for (int i = 0; i < solution.getRows(); ++i) {
+    EXPECT_NEAR(solution(i, 0), 1, 1e-3);
+  }
+}
+
+TEST(test_lu, blocked_determinant_and_inverse) {
+  const int n = 300;
+  Matrix lower(n, n);
+  Matrix upper(n, n);
+  double expected = 1;
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      if (j < i) lower(i, j) = sin(i * n + j) / 4;
+      if (j > i) upper(i, j) = cos(i * n + j);
+    }
+    lower(i, i) = 1;
+    upper(i, i) = 1 + (i % 3 - 1) * 0.01;
+    expected *= upper(i, i);
+  }
+  Matrix matrix = lower * upper;
+  Matrix identity(n, n);
+  for (int i = 0; i < n; ++i) identity(i, i) = 1;
+  int threads = Executor::Instance().getThreadCount();
+  for (int count : {1, 4}) {
+    Executor::Instance().setThreadCount(count);
+    EXPECT_NEAR(matrix.Determinant(), expected, 1e-9);
+    EXPECT_TRUE(matrix * matrix.InverseMatrix() == identity);
+  }
+  Executor::Instance().setThreadCount(threads);
+  for (int j = 0; j < n; ++j) std::swap(matrix(0, j), matrix(n - 1, j));
+  EXPECT_NEAR(matrix.Determinant(), -expected, 1e-9);
+  for (int j = 0; j < n; ++j) matrix(7, j) = matrix(5, j) * 3;
+  EXPECT_NEAR(matrix.Determinant(), 0, 1e-9);
+  EXPECT_ANY_THROW(matrix.InverseMatrix());
+}
+
+TEST(test_executor, task_graph) {
+  Executor executor(4);
+  TaskGraph graph;
+  std::vector<int> order;
+  std::mutex mutex;
+  auto record = [&order, &mutex](int value) {
+    return [&order, &mutex, value] {
+      std::lock_guard<std::mutex> lock(mutex);
+      order.push_back(value);
+    };
+  };
+  int first = graph.Add(record(1));
+  int second = graph.Add(record(2));
+  int third = graph.Add(record(3));
+  graph.Depend(second, first);
+  graph.Depend(third, second);
+  graph.Run(executor);
+  EXPECT_EQ(order, std::vector<int>({1, 2, 3}));
+  TaskGraph failing;
+  failing.Add([] { throw std::logic_error("failure"); });
+  EXPECT_THROW(failing.Run(executor), std::logic_error);
+  std::vector<int> sums(100);
+  executor.ParallelFor(0, 100, 7, [&sums](int begin, int end) {
+    for (int i = begin; i < end; ++i) sums[i] = i;
+  });
+  EXPECT_EQ(sums[99], 99);
+  EXPECT_ANY_THROW(executor.setThreadCount(0));
+}
+
+TEST(test_async, matrix_operations) {
+  double values[3][3] = {
+      {2, 5, 7},
+      {6, 3, 4},
+      {5, -2, -3},
+  };
+  Matrix matrix(3, 3);
+  for (int i = 0; i < matrix.getRows(); ++i) {
+    for (int j = 0; j < matrix.getCols(); ++j) {
+      matrix(i, j) = values[i][j];
+    }
+  }
+  int threads = Executor::Instance().getThreadCount();
+  for (int count : {1, 3}) {
+    Executor::Instance().setThreadCount(count);
+    std::future<Matrix> product = matrix.MulAsync(matrix);
+    std::future<Matrix> inverse = matrix.InverseAsync(1);
+    std::future<double> determinant = matrix.DeterminantAsync();
+    std::future<Matrix> solution = matrix.SolveAsync(matrix);
+    EXPECT_TRUE(product.get() == matrix * matrix);
+    EXPECT_TRUE(inverse.get() == matrix.InverseMatrix());
+    EXPECT_NEAR(determinant.get(), -1, 1e-12);
+    EXPECT_TRUE(solution.get() == matrix.Solve(matrix));
+    EXPECT_THROW(Matrix(1, 7).InverseAsync().get(), std::logic_error);
+    EXPECT_THROW(matrix.MulAsync(Matrix(1, 7)).get(), std::out_of_range);
+  }
+  Executor::Instance().setThreadCount(threads);
+}
+
+TEST(test_async, priority_and_cancellation) {
+  Executor executor(2);
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::future<void> blocker = executor.Async([released] { released.wait(); });
+  std::vector<int> order;
+  std::future<void> low = executor.Async([&order] { order.push_back(1); }, -5);
+  std::future<void> high = executor.Async([&order] { order.push_back(2); }, 5);
+  CancellationToken token;
+  std::future<int> cancelled =
+      executor.Async([] { return 42; }, 0, token);
+  token.Cancel();
+  release.set_value();
+  blocker.get();
+  low.get();
+  high.get();
+  EXPECT_EQ(order, std::vector<int>({2, 1}));
+  EXPECT_THROW(cancelled.get(), CancelledError);
+  EXPECT_FALSE(CancellationToken::Current().IsCancelled());
+}
+
+TEST(test_async, cancellation_of_running_graph) {
+  Executor executor(2);
+  CancellationToken token;
+  std::atomic<int> executed(0);
+  std::future<void> job = executor.Async(
+      [&executor, &executed, token]() mutable {
+        TaskGraph graph;
+        int previous = -1;
+        for (int i = 0; i < 10; ++i) {
+          int task = graph.Add([&executed, &token, i] {
+            executed++;
+            if (i == 2) token.Cancel();
+          });
+          if (previous >= 0) graph.Depend(task, previous);
+          previous = task;
+        }
+        graph.setCancellable(true);
+        graph.Run(executor);
+      },
+      0, token);
+  EXPECT_THROW(job.get(), CancelledError);
+  EXPECT_EQ(executed, 3);
+}
+
+TEST(test_async, cancellation_of_noexcept_operations) {
+  int threads = Executor::Instance().getThreadCount();
+  Executor::Instance().setThreadCount(3);
+  Matrix a = Matrix::FromGenerator(600, 600, [](int i, int j) {
+    return sin(i * 600 + j) + (i == j ? 10 : 0);
+  });
+  Matrix expected = a * a;
+  CancellationToken token;
+  std::promise<void> started, cancelled;
+  std::future<void> resume = cancelled.get_future();
+  std::future<Matrix> job = Executor::Instance().Async(
+      [&] {
+        started.set_value();
+        resume.wait();
+        // Отмена не прерывает noexcept-операции, но прерывает LU
+        Matrix product = a * a + Matrix(a).Transpose() - a.Transpose();
+        EXPECT_THROW(a.InverseMatrix(), CancelledError);
+        return product;
+      },
+      0, token);
+  started.get_future().wait();
+  token.Cancel();
+  cancelled.set_value();
+  EXPECT_TRUE(job.get() == expected);
+  Executor::Instance().setThreadCount(threads);
+}
+
+TEST(test_lazy, fused_expression) {
+  double values[2][3] = {
+      {2, 5, 7},
+      {6, 3, 4},
+  };
+  Matrix a(2, 3);
+  for (int i = 0; i < a.getRows(); ++i) {
+    for (int j = 0; j < a.getCols(); ++j) {
+      a(i, j) = values[i][j];
+    }
+  }
+  Matrix b = a.Transpose();
+  LazyMatrix x(a), y(b);
+  LazyMatrix product = x * y;
+  EvaluationInfo info;
+  Matrix result = (product.Transpose() + product * 2.0 - x * y).Evaluate(&info);
+  EXPECT_TRUE(result == a * b * 2.0);
+  EXPECT_EQ(info.products, 1);
+  EXPECT_EQ(info.passes, 1);
+  EXPECT_EQ(info.allocations, 1);
+  EXPECT_TRUE((x * y).Evaluate(&info) == a * b);
+  EXPECT_EQ(info.passes, 0);
+  EXPECT_EQ(info.allocations, 0);
+  EXPECT_TRUE((y.Transpose() * x.Transpose()).Evaluate() ==
+              (b.Transpose() * a.Transpose()));
+  EXPECT_TRUE(((x - x) * y).Evaluate() == Matrix(2, 2));
+  EXPECT_THROW(x * x, std::out_of_range);
+  EXPECT_THROW(x + y, std::out_of_range);
+  EXPECT_THROW(LazyMatrix{Matrix()}, std::length_error);
+}
+
+TEST(test_lazy, transpose_folding_and_buffer_reuse) {
+  double values[3][3] = {
+      {2, 5, 7},
+      {6, 3, 4},
+      {5, -2, -3},
+  };
+  Matrix a(3, 3);
+  for (int i = 0; i < a.getRows(); ++i) {
+    for (int j = 0; j < a.getCols(); ++j) {
+      a(i, j) = values[i][j];
+    }
+  }
+  LazyMatrix x(a);
+  EvaluationInfo info;
+  Matrix folded = ((x.Transpose() * 3.0) * x.Transpose()).Evaluate(&info);
+  EXPECT_TRUE(folded == a.Transpose() * a.Transpose() * 3.0);
+  EXPECT_EQ(info.products, 1);
+  EXPECT_EQ(info.allocations, 1);
+  // Цепочка произведений: каждый буфер освобождается до следующего
+  LazyMatrix chain = x;
+  Matrix expected = a;
+  for (int i = 0; i < 4; ++i) {
+    chain = chain * x;
+    expected = expected * a;
+  }
+  Matrix result = (chain + x).Evaluate(&info);
+  EXPECT_TRUE(result == expected + a);
+  EXPECT_EQ(info.products, 4);
+  EXPECT_EQ(info.allocations, 2);
+  Matrix combined = ((x + LazyMatrix(a * 2.0)) * x).Evaluate(&info);
+  EXPECT_TRUE(combined == (a + a * 2.0) * a);
+  EXPECT_EQ(info.passes, 1);
+}
+
+TEST(test_power, pow) {
+  double values[3][3] = {
+      {2, 5, 7},
+      {6, 3, 4},
+      {5, -2, -3},
+  };
+  Matrix matrix(3, 3);
+  for (int i = 0; i < matrix.getRows(); ++i) {
+    for (int j = 0; j < matrix.getCols(); ++j) {
+      matrix(i, j) = values[i][j];
+    }
+  }
+  Matrix expected(3, 3);
+  for (int i = 0; i < 3; ++i) expected(i, i) = 1;
+  EXPECT_TRUE(matrix.Pow(0) == expected);
+  for (int k = 1; k <= 11; ++k) {
+    expected *= matrix;
+    EXPECT_TRUE(matrix.Pow(k) == expected);
+  }
+  EXPECT_TRUE(matrix.Pow(-3) == matrix.InverseMatrix().Pow(3));
+  EXPECT_THROW(Matrix(2, 3).Pow(2), std::logic_error);
+}
+
+TEST(test_power, markov_chain) {
+  double values[2][2] = {
+      {0.9, 0.1},
+      {0.5, 0.5},
+  };
+  Matrix transition(2, 2);
+  for (int i = 0; i < transition.getRows(); ++i) {
+    for (int j = 0; j < transition.getCols(); ++j) {
+      transition(i, j) = values[i][j];
+    }
+  }
+  // Стационарное распределение (5/6, 1/6)
+  Matrix limit = transition.Pow(1000000);
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_NEAR(limit(i, 0), 5.0 / 6, 1e-9);
+    EXPECT_NEAR(limit(i, 1), 1.0 / 6, 1e-9);
+  }
+}
+
+TEST(test_power, exp) {
+  Matrix nilpotent(2, 2);
+  nilpotent(0, 1) = 1;
+  Matrix expected(2, 2);
+  expected(0, 0) = expected(0, 1) = expected(1, 1) = 1;
+  EXPECT_TRUE(nilpotent.Exp() == expected);
+  for (double t : {1e-3, 0.5, 3.0, 40.0}) {
+    Matrix rotation(2, 2);
+    rotation(0, 1) = -t;
+    rotation(1, 0) = t;
+    Matrix result = rotation.Exp();
+    EXPECT_NEAR(result(0, 0), cos(t), 1e-12);
+    EXPECT_NEAR(result(0, 1), -sin(t), 1e-12);
+    EXPECT_NEAR(result(1, 0), sin(t), 1e-12);
+    EXPECT_NEAR(result(1, 1), cos(t), 1e-12);
+  }
+  double values[3][3] = {
+      {2, 5, 7},
+      {6, 3, 4},
+      {5, -2, -3},
+  };
+  Matrix matrix(3, 3);
+  for (int i = 0; i < matrix.getRows(); ++i) {
+    for (int j = 0; j < matrix.getCols(); ++j) {
+      matrix(i, j) = values[i][j] / 10;
+    }
+  }
+  Matrix identity(3, 3);
+  for (int i = 0; i < 3; ++i) identity(i, i) = 1;
+  EXPECT_TRUE(matrix.Exp() * (matrix * -1).Exp() == identity);
+  EXPECT_NEAR(matrix.Exp().Determinant(), exp(0.2), 1e-12);
+  EXPECT_THROW(Matrix(2, 3).Exp(), std::logic_error);
+  EXPECT_THROW(Matrix().Exp(), std::length_error);
+  EXPECT_THROW(Matrix().Pow(2), std::length_error);
+}
+
+TEST(test_incremental, inverse_updates) {
+  double values[3][3] = {
+      {2, 5, 7},
+      {6, 3, 4},
+      {5, -2, -3},
+  };
+  Matrix matrix(3, 3);
+  for (int i = 0; i < matrix.getRows(); ++i) {
+    for (int j = 0; j < matrix.getCols(); ++j) {
+      matrix(i, j) = values[i][j];
+    }
+  }
+  IncrementalInverse inverse(matrix);
+  Matrix row(1, 3);
+  row(0, 0) = 1;
+  row(0, 1) = 4;
+  row(0, 2) = -1;
+  inverse.UpdateRow(1, row);
+  for (int j = 0; j < 3; ++j) matrix(1, j) = row(0, j);
+  EXPECT_TRUE(inverse.getInverse() == matrix.InverseMatrix());
+  Matrix column = row.Transpose();
+  inverse.UpdateColumn(2, column);
+  for (int i = 0; i < 3; ++i) matrix(i, 2) = column(i, 0);
+  EXPECT_TRUE(inverse.getInverse() == matrix.InverseMatrix());
+  Matrix u(3, 2), v(3, 2);
+  u(0, 0) = v(2, 0) = u(1, 1) = 1;
+  v(0, 1) = 3;
+  inverse.Update(u, v);
+  matrix += u * v.Transpose();
+  EXPECT_TRUE(inverse.getMatrix() == matrix);
+  EXPECT_TRUE(inverse.getInverse() == matrix.InverseMatrix());
+  EXPECT_TRUE(inverse.Solve(matrix) == matrix.Solve(matrix));
+  // Строка, совпадающая с другой, делает матрицу вырожденной
+  Matrix same(1, 3);
+  for (int j = 0; j < 3; ++j) same(0, j) = matrix(0, j);
+  EXPECT_THROW(inverse.UpdateRow(1, same), std::logic_error);
+  EXPECT_TRUE(inverse.getMatrix() == matrix);
+  EXPECT_THROW(inverse.UpdateRow(3, row), std::out_of_range);
+  EXPECT_THROW(inverse.Update(u, row), std::out_of_range);
+}
+
+TEST(test_incremental, inverse_append_and_remove) {
+  double values[4][4] = {
+      {4, 1, 2, 0},
+      {1, 5, -1, 2},
+      {2, -1, 6, 1},
+      {0, 2, 1, 3},
+  };
+  Matrix full(4, 4);
+  for (int i = 0; i < full.getRows(); ++i) {
+    for (int j = 0; j < full.getCols(); ++j) {
+      full(i, j) = values[i][j];
+    }
+  }
+  Matrix part(full);
+  part.setRows(3);
+  part.setCols(3);
+  IncrementalInverse inverse(part);
+  Matrix column(3, 1), row(1, 4);
+  for (int i = 0; i < 3; ++i) column(i, 0) = full(i, 3);
+  for (int j = 0; j < 4; ++j) row(0, j) = full(3, j);
+  inverse.Append(column, row);
+  EXPECT_TRUE(inverse.getMatrix() == full);
+  EXPECT_TRUE(inverse.getInverse() == full.InverseMatrix());
+  inverse.Remove(3);
+  EXPECT_TRUE(inverse.getInverse() == part.InverseMatrix());
+  inverse.setSize(5);
+  EXPECT_EQ(inverse.getSize(), 5);
+  EXPECT_DOUBLE_EQ(inverse.getInverse()(4, 4), 1);
+  EXPECT_TRUE(inverse.getInverse() == inverse.getMatrix().InverseMatrix());
+  inverse.setSize(2);
+  part.setRows(2);
+  part.setCols(2);
+  EXPECT_TRUE(inverse.getInverse() == part.InverseMatrix());
+  EXPECT_THROW(inverse.setSize(0), std::length_error);
+}
+
+TEST(test_incremental, periodic_refactorization) {
+  Matrix matrix(20, 20);
+  for (int i = 0; i < 20; ++i) {
+    for (int j = 0; j < 20; ++j) {
+      matrix(i, j) = (i == j ? 20 : 0) + sin(i * 20 + j);
+    }
+  }
+  IncrementalInverse checked(matrix, 5, 0);
+  IncrementalInverse tolerant(matrix, 5);
+  Matrix row(1, 20);
+  for (int step = 0; step < 50; ++step) {
+    int index = step % 20;
+    for (int j = 0; j < 20; ++j) row(0, j) = matrix(index, j) + cos(step + j);
+    for (int j = 0; j < 20; ++j) matrix(index, j) = row(0, j);
+    checked.UpdateRow(index, row);
+    tolerant.UpdateRow(index, row);
+  }
+  EXPECT_EQ(checked.getRefactorizations(), 10);
+  EXPECT_EQ(tolerant.getRefactorizations(), 0);
+  EXPECT_TRUE(tolerant.getInverse() == matrix.InverseMatrix());
+  EXPECT_THROW(IncrementalInverse(matrix, 0), std::out_of_range);
+}
+
+TEST(test_incremental, cholesky) {
+  double values[4][4] = {
+      {4, 1, 2, 0},
+      {1, 5, -1, 2},
+      {2, -1, 6, 1},
+      {0, 2, 1, 3},
+  };
+  Matrix matrix(4, 4);
+  for (int i = 0; i < matrix.getRows(); ++i) {
+    for (int j = 0; j < matrix.getCols(); ++j) {
+      matrix(i, j) = values[i][j];
+    }
+  }
+  CholeskyFactor factor(matrix);
+  Matrix lower = factor.getFactor();
+  EXPECT_TRUE(lower * lower.Transpose() == matrix);
+  EXPECT_DOUBLE_EQ(lower(0, 1), 0);
+  Matrix x(4, 1);
+  x(0, 0) = 1;
+  x(2, 0) = -2;
+  x(3, 0) = 0.5;
+  factor.Update(x);
+  matrix += x * x.Transpose();
+  lower = factor.getFactor();
+  EXPECT_TRUE(lower * lower.Transpose() == matrix);
+  factor.Downdate(x);
+  matrix -= x * x.Transpose();
+  lower = factor.getFactor();
+  EXPECT_TRUE(lower * lower.Transpose() == matrix);
+  EXPECT_TRUE(factor.Solve(matrix) == matrix.Solve(matrix));
+  x(0, 0) = 3;
+  EXPECT_THROW(factor.Downdate(x), std::logic_error);
+  EXPECT_TRUE(factor.getFactor() == lower);
+  factor.Remove(1);
+  lower = factor.getFactor();
+  EXPECT_TRUE(lower * lower.Transpose() == factor.getMatrix());
+  EXPECT_DOUBLE_EQ(factor.getMatrix()(1, 1), 6);
+  Matrix column(4, 1);
+  for (int i = 0; i < 4; ++i) column(i, 0) = values[1][i];
+  std::swap(column(1, 0), column(3, 0));
+  factor.Append(column);
+  lower = factor.getFactor();
+  EXPECT_TRUE(lower * lower.Transpose() == factor.getMatrix());
+  factor.setSize(6);
+  EXPECT_DOUBLE_EQ(factor.getFactor()(5, 5), 1);
+  factor.setSize(3);
+  lower = factor.getFactor();
+  EXPECT_TRUE(lower * lower.Transpose() == factor.getMatrix());
+  matrix(0, 1) = 7;
+  EXPECT_THROW(CholeskyFactor{matrix}, std::logic_error);
+  matrix(1, 0) = 7;
+  EXPECT_THROW(CholeskyFactor{matrix}, std::logic_error);
+}
+
+TEST(test_fingerprint, equality_and_invalidation) {
+  double values[3][3] = {
+      {2, 5, 7},
+      {6, 3, 4},
+      {5, -2, -3},
+  };
+  Matrix matrix(3, 3);
+  for (int i = 0; i < matrix.getRows(); ++i) {
+    for (int j = 0; j < matrix.getCols(); ++j) {
+      matrix(i, j) = values[i][j];
+    }
+  }
+  Matrix close(matrix);
+  for (int i = 0; i < 3; ++i) close(i, i) += 5e-8;
+  EXPECT_TRUE(matrix == close);
+  EXPECT_EQ(matrix.getHash(), Matrix(matrix).getHash());
+  // Отпечатки уже посчитаны; изменения должны их сбрасывать
+  close(1, 1) += 1;
+  EXPECT_FALSE(matrix == close);
+  close(1, 1) -= 1;
+  EXPECT_TRUE(matrix == close);
+  close *= 2;
+  EXPECT_FALSE(matrix == close);
+  close *= 0.5;
+  EXPECT_TRUE(matrix == close);
+  close += matrix;
+  EXPECT_FALSE(matrix == close);
+  close -= matrix;
+  EXPECT_TRUE(matrix == close);
+  close = matrix;
+  EXPECT_TRUE(matrix == close);
+  close = matrix * 3;
+  EXPECT_FALSE(matrix == close);
+  // Совпадающие суммы не должны давать ложного отказа
+  Matrix swapped(matrix);
+  std::swap(swapped(0, 0), swapped(1, 1));
+  EXPECT_FALSE(matrix == swapped);
+  std::swap(swapped(0, 0), swapped(1, 1));
+  EXPECT_TRUE(matrix == swapped);
+  EXPECT_NE(matrix.getHash(), (matrix * 2).getHash());
+}
+
+TEST(test_fingerprint, escaped_reference) {
+  double values[4] = {1, 2, 3, 4};
+  Matrix c = Matrix::FromBuffer(2, 2, values);
+  Matrix d = Matrix::FromBuffer(2, 2, values);
+  EXPECT_EQ(c.getHash(), d.getHash());
+  EXPECT_TRUE(c == d);
+  // Запись через сохранённую ссылку после сравнения
+  double &r = d(0, 0);
+  r = 2;
+  EXPECT_FALSE(c == d);
+  r = 1;
+  EXPECT_TRUE(c == d);
+  r = 2;
+  EXPECT_FALSE(c == d);
+  EXPECT_NE(c.getHash(), d.getHash());
+  // Запись целиком снова включает отпечаток
+  d = c;
+  EXPECT_TRUE(c == d);
+  EXPECT_EQ(c.getHash(), d.getHash());
+  Matrix e = Matrix::FromGenerator(2, 2, [](int i, int j) {
+    return 2.0 * i + j + 1;
+  });
+  EXPECT_TRUE(c == e);
+  EXPECT_FALSE(c == e * 2);
+  // Запись на месте не отменяет выданную ссылку
+  double shifted[4] = {5, 2, 3, 4};
+  Matrix m = Matrix::FromBuffer(2, 2, values);
+  Matrix t2 = Matrix::FromBuffer(2, 2, shifted);
+  double &s = m(0, 0);
+  for (int step = 0; step < 3; ++step) {
+    if (step == 0) m.MulNumber(1.0);
+    if (step == 1) m.SumMatrix(Matrix(2, 2));
+    if (step == 2) m.SubMatrix(Matrix(2, 2));
+    s = 1;
+    m.getHash();
+    t2.getHash();
+    EXPECT_FALSE(m == t2);
+    s = 5;
+    EXPECT_TRUE(m == t2);
+  }
+}
+
+TEST(test_fingerprint, matrix_cache) {
+  double values[3][3] = {
+      {2, 5, 7},
+      {6, 3, 4},
+      {5, -2, -3},
+  };
+  Matrix matrix(3, 3);
+  for (int i = 0; i < matrix.getRows(); ++i) {
+    for (int j = 0; j < matrix.getCols(); ++j) {
+      matrix(i, j) = values[i][j];
+    }
+  }
+  MatrixCache cache(2);
+  EXPECT_TRUE(cache.InverseMatrix(matrix) == matrix.InverseMatrix());
+  EXPECT_TRUE(cache.InverseMatrix(Matrix(matrix)) == matrix.InverseMatrix());
+  EXPECT_NEAR(cache.Determinant(matrix), -1, 1e-12);
+  EXPECT_NEAR(cache.Determinant(matrix), -1, 1e-12);
+  EXPECT_EQ(cache.getHits(), 2);
+  EXPECT_EQ(cache.getMisses(), 2);
+  EXPECT_EQ(cache.getSize(), 1);
+  Matrix other = matrix * 2;
+  EXPECT_NEAR(cache.Determinant(other), -8, 1e-12);
+  EXPECT_NEAR(cache.Determinant(matrix), -1, 1e-12);
+  // Вытесняется other как дольше всего не использованная
+  EXPECT_NEAR(cache.Determinant(matrix * 3), -27, 1e-12);
+  EXPECT_EQ(cache.getSize(), 2);
+  EXPECT_EQ(cache.getMisses(), 4);
+  EXPECT_NEAR(cache.Determinant(matrix), -1, 1e-12);
+  EXPECT_NEAR(cache.Determinant(other), -8, 1e-12);
+  EXPECT_EQ(cache.getMisses(), 5);
+  EXPECT_THROW(cache.InverseMatrix(Matrix(2, 2)), std::logic_error);
+  cache.Clear();
+  EXPECT_EQ(cache.getSize(), 0);
+  EXPECT_EQ(cache.getHits(), 0);
+  EXPECT_THROW(MatrixCache(0), std::out_of_range);
+}
+
+TEST(test_placement, policies) {
+  PlacementPolicy saved = Matrix::getPlacementPolicy();
+  int threads = Executor::Instance().getThreadCount();
+  Executor::Instance().setThreadCount(3);
+  EXPECT_GE(Matrix::getNumaNodes(), 1);
+  // 600 x 600 больше порога, с которого действует политика
+  Matrix identity(600, 600);
+  for (int i = 0; i < 600; ++i) identity(i, i) = 1;
+  for (Placement placement :
+       {Placement::kFirstTouch, Placement::kInterleave, Placement::kBind}) {
+    for (bool huge_pages : {false, true}) {
+      PlacementPolicy policy;
+      policy.placement = placement;
+      policy.huge_pages = huge_pages;
+      Matrix::setPlacementPolicy(policy);
+      Matrix matrix(600, 600);
+      double sum = 0;
+      for (int i = 0; i < 600; ++i) {
+        for (int j = 0; j < 600; ++j) sum += fabs(matrix(i, j));
+      }
+      EXPECT_EQ(sum, 0);
+      matrix(599, 1) = 2;
+      EXPECT_TRUE(matrix * identity == matrix);
+    }
+  }
+  PlacementPolicy missing;
+  missing.placement = Placement::kBind;
+  missing.node = Matrix::getNumaNodes();
+  EXPECT_THROW(Matrix::setPlacementPolicy(missing), std::out_of_range);
+  Matrix::setPlacementPolicy(saved);
+  Executor::Instance().setThreadCount(threads);
+}
+
+TEST(test_placement, first_touch_copies) {
+  PlacementPolicy saved = Matrix::getPlacementPolicy();
+  int threads = Executor::Instance().getThreadCount();
+  Matrix::setPlacementPolicy(PlacementPolicy());
+  // Все буферы больше порога; результаты сравниваются с однопоточными
+  std::vector<double> values(700 * 600);
+  for (size_t k = 0; k < values.size(); ++k) values[k] = (k * 37 % 101) - 50;
+  Matrix expected[7];
+  for (int pass = 0; pass < 2; ++pass) {
+    Executor::Instance().setThreadCount(pass ? 3 : 1);
+    Matrix matrix = Matrix::FromBuffer(700, 600, values.data());
+    Matrix assigned;
+    assigned = matrix;
+    Matrix resized(matrix), square = Matrix::Filled(600, 600, 0.001);
+    resized.setRows(800);
+    resized.setCols(500);
+    square.SumMatrix(Matrix::Identity(600));
+    Matrix results[7] = {Matrix(matrix),
+                         assigned,
+                         matrix.Transpose(),
+                         resized,
+                         square.Pow(3),
+                         square.Exp(),
+                         square.Solve(matrix.Transpose())};
+    for (int k = 0; k < 7; ++k) {
+      if (pass) {
+        EXPECT_TRUE(results[k] == expected[k]) << k;
+      } else {
+        expected[k] = results[k];
+      }
+    }
+  }
+  EXPECT_EQ(expected[2](599, 699), values[699 * 600 + 599]);
+  EXPECT_EQ(expected[3](799, 499), 0);
+  EXPECT_EQ(expected[3](699, 499), values[699 * 600 + 499]);
+  Matrix::setPlacementPolicy(saved);
+  Executor::Instance().setThreadCount(threads);
+}
+
+TEST(test_construction, factories) {
+  double values[2][3] = {
+      {2, 5, 7},
+      {6, 3, 4},
+  };
+  Matrix identity = Matrix::Identity(3);
+  Matrix filled = Matrix::Filled(2, 3, 1.5);
+  Matrix copied = Matrix::FromBuffer(2, 3, &values[0][0]);
+  std::unique_ptr<double[]> buffer(new double[6]);
+  for (int k = 0; k < 6; ++k) buffer[k] = values[k / 3][k % 3];
+  double *data = buffer.get();
+  Matrix adopted = Matrix::FromBuffer(2, 3, std::move(buffer));
+  Matrix generated =
+      Matrix::FromGenerator(2, 3, [&](int i, int j) { return values[i][j]; });
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      EXPECT_EQ(identity(i, j), i == j ? 1 : 0);
+    }
+  }
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      EXPECT_EQ(filled(i, j), 1.5);
+      EXPECT_EQ(copied(i, j), values[i][j]);
+      EXPECT_EQ(adopted(i, j), values[i][j]);
+      EXPECT_EQ(generated(i, j), values[i][j]);
+    }
+  }
+  EXPECT_EQ(&adopted(0, 0), data);
+  values[0][0] = 0;
+  EXPECT_EQ(copied(0, 0), 2);
+  // Забранный буфер переживает перемещение, копирование и изменение размера
+  Matrix moved = std::move(adopted);
+  Matrix copy(moved);
+  moved.setCols(4);
+  EXPECT_EQ(moved(1, 2), 4);
+  EXPECT_EQ(moved(1, 3), 0);
+  EXPECT_TRUE(copy == generated);
+  copy = Matrix::FromBuffer(600, 600, std::unique_ptr<double[]>(
+                                          new double[600 * 600]()));
+  EXPECT_EQ(copy(599, 599), 0);
+  Matrix raw(2, 3, uninitialized);
+  EXPECT_EQ(raw.getRows(), 2);
+  raw.setRows(4);
+  EXPECT_EQ(raw(3, 2), 0);
+  EXPECT_THROW(Matrix(0, 3, uninitialized), std::length_error);
+  EXPECT_THROW(Matrix::FromBuffer(2, 3, nullptr), std::invalid_argument);
+  EXPECT_THROW(Matrix::FromBuffer(0, 3, std::unique_ptr<double[]>(
+                                            new double[1])),
+               std::length_error);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
 